@@ -0,0 +1,176 @@
+#ifndef __BITBOARD_H__
+#define __BITBOARD_H__
+
+#include <stdint.h>
+#include "geometry.h"
+
+/*
+ * Helpers for working with a board stored as a 64-bit mask, one bit per square.
+ * Square (x, y) is bit x + 8*y, the same indexing Board uses for its bitsets.
+ */
+
+inline int popCount(uint64_t b) {
+	return __builtin_popcountll(b);
+}
+
+inline int firstSquare(uint64_t b) {
+	return __builtin_ctzll(b);
+}
+
+inline int lastSquare(uint64_t b) {
+	return 63 - __builtin_clzll(b);
+}
+
+/*
+ * Empty squares from which a run of opp stones in one direction ends in an own stone. Each run can be at most 6 
+ * stones long, so 5 more steps after the first find all of them.
+ */
+#define MOVES_IN_DIRECTION(shift) \
+	t = shift(own) & opp; \
+	t |= shift(t) & opp; t |= shift(t) & opp; t |= shift(t) & opp; \
+	t |= shift(t) & opp; t |= shift(t) & opp; \
+	moves |= shift(t);
+
+/*
+ * All squares where the side owning own may legally move.
+ */
+inline uint64_t legalMoveMask(uint64_t own, uint64_t opp) {
+	uint64_t moves = 0;
+	uint64_t t;
+	MOVES_IN_DIRECTION(shiftEast)
+	MOVES_IN_DIRECTION(shiftWest)
+	MOVES_IN_DIRECTION(shiftNorth)
+	MOVES_IN_DIRECTION(shiftSouth)
+	MOVES_IN_DIRECTION(shiftNorthEast)
+	MOVES_IN_DIRECTION(shiftNorthWest)
+	MOVES_IN_DIRECTION(shiftSouthEast)
+	MOVES_IN_DIRECTION(shiftSouthWest)
+	return moves & ~(own | opp);
+}
+
+#undef MOVES_IN_DIRECTION
+
+/*
+ * Opponent stones turned over by the side owning own moving on square. Making the move is then
+ * own |= flips | (1 << square), opp ^= flips. Works one ray at a time: the first square along a ray that is not
+ * the opponent's ends the run, and the run is turned over if that square is ours. On rays running towards higher
+ * squares it is the lowest set bit, on the others the highest.
+ */
+inline uint64_t flipMask(uint64_t own, uint64_t opp, int square) {
+	uint64_t flips = 0;
+	for (int d = 0; d < 8; d++) {
+		uint64_t ray = GEOMETRY.rays[d][square];
+		uint64_t stops = ray & ~opp;
+		if (stops == 0)
+			continue; //opponent stones up to the edge
+		int end = (d < 4) ? firstSquare(stops) : lastSquare(stops);
+		if ((own >> end) & 1)
+			flips |= ray & ~GEOMETRY.rays[d][end] & ~(1ULL << end);
+	}
+	return flips;
+}
+
+/*
+ * y -> 7 - y
+ */
+inline uint64_t flipVertical(uint64_t b) {
+	return __builtin_bswap64(b);
+}
+
+/*
+ * x -> 7 - x
+ */
+inline uint64_t mirrorHorizontal(uint64_t b) {
+	const uint64_t k1 = 0x5555555555555555ULL;
+	const uint64_t k2 = 0x3333333333333333ULL;
+	const uint64_t k4 = 0x0f0f0f0f0f0f0f0fULL;
+	b = ((b >> 1) & k1) | ((b & k1) << 1);
+	b = ((b >> 2) & k2) | ((b & k2) << 2);
+	b = ((b >> 4) & k4) | ((b & k4) << 4);
+	return b;
+}
+
+/*
+ * (x, y) -> (y, x)
+ */
+inline uint64_t flipDiagonal(uint64_t b) {
+	const uint64_t k1 = 0x5500550055005500ULL;
+	const uint64_t k2 = 0x3333000033330000ULL;
+	const uint64_t k4 = 0x0f0f0f0f00000000ULL;
+	uint64_t t;
+	t = k4 & (b ^ (b << 28));
+	b ^= t ^ (t >> 28);
+	t = k2 & (b ^ (b << 14));
+	b ^= t ^ (t >> 14);
+	t = k1 & (b ^ (b << 7));
+	b ^= t ^ (t >> 7);
+	return b;
+}
+
+/*
+ * The 8 symmetries of the board. Bit 0 flips vertically, bit 1 mirrors horizontally and bit 2 then swaps x and y,
+ * in that order. Transform 0 is the identity.
+ */
+inline uint64_t transform(int t, uint64_t b) {
+	if (t & 1)
+		b = flipVertical(b);
+	if (t & 2)
+		b = mirrorHorizontal(b);
+	if (t & 4)
+		b = flipDiagonal(b);
+	return b;
+}
+
+/*
+ * The transform that undoes t. Flips are their own inverses; with the diagonal swap applied last, undoing it means
+ * swapping first, which turns a vertical flip into a horizontal one and vice versa.
+ */
+inline int inverseTransform(int t) {
+	if (!(t & 4))
+		return t;
+	return 4 | ((t & 1) << 1) | ((t & 2) >> 1);
+}
+
+inline int transformSquare(int t, int square) {
+	return firstSquare(transform(t, 1ULL << square));
+}
+
+/*
+ * 64-bit finalizer from splitmix64; scatters every input bit over the whole word.
+ */
+inline uint64_t mixBits(uint64_t h) {
+	h ^= h >> 30;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27;
+	h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+/*
+ * Hash of a position given the black and white masks and whether black is to move.
+ */
+inline uint64_t hashPosition(uint64_t black, uint64_t white, bool blackToMove) {
+	uint64_t h = mixBits(black + 0x9e3779b97f4a7c15ULL) ^ mixBits(white ^ 0x2545f4914f6cdd1dULL);
+	return blackToMove ? mixBits(h) : h;
+}
+
+/*
+ * Hash shared by all 8 symmetric forms of a position: the smallest hash over the transforms. The transform that
+ * produced it is stored in symmetry, so that squares can be mapped into (and, with inverseTransform, out of) the
+ * canonical orientation.
+ */
+inline uint64_t canonicalHash(uint64_t black, uint64_t white, bool blackToMove, int &symmetry) {
+	uint64_t best = hashPosition(black, white, blackToMove);
+	symmetry = 0;
+	for (int t = 1; t < 8; t++) {
+		uint64_t h = hashPosition(transform(t, black), transform(t, white), blackToMove);
+		if (h < best) {
+			best = h;
+			symmetry = t;
+		}
+	}
+	return best;
+}
+
+#endif
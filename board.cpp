@@ -1,4 +1,5 @@
 #include "board.h"
+#include "bitboard.h"
 
 /*
  * Make a standard 8x8 othello board and initialize it to the standard setup.
@@ -41,8 +42,26 @@ void Board::set(Side side, int x, int y) {
     black.set(x + 8*y, side == BLACK);
 }
 
-bool Board::onBoard(int x, int y) {
-    return(0 <= x && x < 8 && 0 <= y && y < 8);
+/*
+ * The stones of the given side and of the other one, as masks.
+ */
+void Board::getSideBits(Side side, uint64_t &own, uint64_t &opp) {
+    own = (side == BLACK) ? getBlackBits() : getWhiteBits();
+    opp = (side == BLACK) ? getWhiteBits() : getBlackBits();
+}
+
+/*
+ * Plays a legal move on the given square: places the stone and turns over the stones it captures.
+ */
+void Board::play(int square, Side side) {
+    uint64_t own, opp;
+    getSideBits(side, own, opp);
+    bitset<64> flips(flipMask(own, opp, square));
+    if (side == BLACK)
+        black |= flips;
+    else
+        black &= ~flips;
+    set(side, square % 8, square / 8);
 }
 
  
@@ -58,13 +77,9 @@ bool Board::isDone() {
  * Returns true if there are legal moves for the given side.
  */
 bool Board::hasMoves(Side side) {
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            Move move(i, j);
-            if (checkMove(&move, side)) return true;
-        }
-    }
-    return false;
+    uint64_t own, opp;
+    getSideBits(side, own, opp);
+    return legalMoveMask(own, opp) != 0;
 }
 
 /*
@@ -74,31 +89,16 @@ bool Board::checkMove(Move *m, Side side) {
     // Passing is only legal if you have no moves.
     if (m == NULL) return !hasMoves(side);
 
-    int X = m->getX();
-    int Y = m->getY();
+    int square = m->getX() + 8 * m->getY();
 
     // Make sure the square hasn't already been taken.
-    if (occupied(X, Y)) return false;
-
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            // Is there a capture in that direction?
-            int x = X + dx;
-            int y = Y + dy;
-            if (onBoard(x, y) && get(other, x, y)) {
-                do {
-                    x += dx;
-                    y += dy;
-                } while (onBoard(x, y) && get(other, x, y));
-
-                if (onBoard(x, y) && get(side, x, y)) return true;
-            }
-        }
-    }
-    return false;
+    if (taken[square]) return false;
+
+    // Is there a capture in any direction?
+    uint64_t own, opp;
+    getSideBits(side, own, opp);
+    if ((GEOMETRY.neighbors[square] & opp) == 0) return false;
+    return flipMask(own, opp, square) != 0;
 }
 
 /*
@@ -111,34 +111,7 @@ void Board::doMove(Move *m, Side side) {
     // Ignore if move is invalid.
     if (!checkMove(m, side)) return;
 
-    int X = m->getX();
-    int Y = m->getY();
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            int x = X;
-            int y = Y;
-            do {
-                x += dx;
-                y += dy;
-            } while (onBoard(x, y) && get(other, x, y));
-
-            if (onBoard(x, y) && get(side, x, y)) {
-                x = X;
-                y = Y;
-                x += dx;
-                y += dy;
-                while (onBoard(x, y) && get(other, x, y)) {
-                    set(side, x, y);
-                    x += dx;
-                    y += dy;
-                }
-            }
-        }
-    }
-    set(side, X, Y);
+    play(m->getX() + 8 * m->getY(), side);
 }
 
 /*
@@ -188,37 +161,7 @@ void Board::doMoveUnchecked(Move* m, Side side) {
 	// A NULL move means pass.
     if (m == NULL) return;
 
-    // Ignore if move is invalid.
-    if (!checkMove(m, side)) return;
-
-    int X = m->getX();
-    int Y = m->getY();
-    Side other = (side == BLACK) ? WHITE : BLACK;
-    for (int dx = -1; dx <= 1; dx++) {
-        for (int dy = -1; dy <= 1; dy++) {
-            if (dy == 0 && dx == 0) continue;
-
-            int x = X;
-            int y = Y;
-            do {
-                x += dx;
-                y += dy;
-            } while (onBoard(x, y) && get(other, x, y));
-
-            if (onBoard(x, y) && get(side, x, y)) {
-                x = X;
-                y = Y;
-                x += dx;
-                y += dy;
-                while (onBoard(x, y) && get(other, x, y)) {
-                    set(side, x, y);
-                    x += dx;
-                    y += dy;
-                }
-            }
-        }
-    }
-    set(side, X, Y);
+    play(m->getX() + 8 * m->getY(), side);
 }
 
 void Board::undoMove(Move * m) {
@@ -232,3 +175,18 @@ int Board::countEmpty() {
 	return 64 - countBlack() - countWhite();
 }
 
+uint64_t Board::getBlackBits() {
+	return black.to_ullong();
+}
+
+uint64_t Board::getWhiteBits() {
+	return (taken & ~black).to_ullong();
+}
+
+/*
+ * Sets up the position from black and white masks (x + 8*y bits).
+ */
+void Board::setBits(uint64_t blackBits, uint64_t whiteBits) {
+	black = bitset<64>(blackBits);
+	taken = bitset<64>(blackBits | whiteBits);
+}
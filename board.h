@@ -2,6 +2,7 @@
 #define __BOARD_H__
 
 #include <bitset>
+#include <stdint.h>
 #include "common.h"
 #include <vector>
 using namespace std;
@@ -17,7 +18,8 @@ private:
     bool occupied(int x, int y);
     bool get(Side side, int x, int y);
     void set(Side side, int x, int y);
-    bool onBoard(int x, int y);
+    void getSideBits(Side side, uint64_t &own, uint64_t &opp);
+    void play(int square, Side side);
       
 public:
     Board();
@@ -44,6 +46,9 @@ public:
     
     // helper methods
     int countEmpty();
+    uint64_t getBlackBits();
+    uint64_t getWhiteBits();
+    void setBits(uint64_t blackBits, uint64_t whiteBits);
 };
 
 #endif
@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <climits>
+#include <set>
+#include "bitboard.h"
+#include "player.h"
+#include "book.h"
+
+#define BOOK_TABLE_KB 65536 //the book is built offline, so the table can be as large as the search wants
+
+static bool keyLess(const BookEntry &entry, uint64_t key) {
+	return entry.key < key;
+}
+
+static bool entryLess(const BookEntry &a, const BookEntry &b) {
+	return a.key < b.key;
+}
+
+OpeningBook::OpeningBook() {
+	entries = NULL;
+	numEntries = 0;
+}
+
+/*
+ * Points the book at the TABLE_BOOK section of tables. Returns false (leaving the book empty) if there is none.
+ */
+bool OpeningBook::attach(const SharedTables &tables) {
+	size_t bytes;
+	const void *data = tables.section(TABLE_BOOK, bytes);
+	if (data == NULL || bytes % sizeof(BookEntry) != 0) {
+		entries = NULL;
+		numEntries = 0;
+		return false;
+	}
+	entries = static_cast<const BookEntry *>(data);
+	numEntries = bytes / sizeof(BookEntry);
+	return true;
+}
+
+size_t OpeningBook::size() const {
+	return numEntries;
+}
+
+/*
+ * Looks the position up. On a hit, square is the book move (x + 8*y) in this position's own orientation and
+ * score its score for the side to move.
+ */
+bool OpeningBook::find(uint64_t black, uint64_t white, bool blackToMove, int &square, int &score) const {
+	if (numEntries == 0)
+		return false;
+	int symmetry;
+	uint64_t key = canonicalHash(black, white, blackToMove, symmetry);
+	const BookEntry *entry = std::lower_bound(entries, entries + numEntries, key, keyLess);
+	if (entry == entries + numEntries || entry->key != key)
+		return false;
+	square = transformSquare(inverseTransform(symmetry), entry->move);
+	score = entry->score;
+	return true;
+}
+
+/*
+ * Every position reached in fewer than plies moves from the start, once per symmetry class, with the side to
+ * move first in each pair of masks.
+ */
+static void collectPositions(uint64_t own, uint64_t opp, bool blackToMove, int plies, std::set<uint64_t> &seen,
+		std::vector<uint64_t> &positions) {
+	if (plies == 0)
+		return;
+	uint64_t moves = legalMoveMask(own, opp);
+	if (moves == 0)
+		return;
+	int symmetry;
+	uint64_t key = canonicalHash(blackToMove ? own : opp, blackToMove ? opp : own, blackToMove, symmetry);
+	if (!seen.insert(key).second)
+		return;
+	positions.push_back(own);
+	positions.push_back(opp);
+	while (moves) {
+		int square = firstSquare(moves);
+		moves &= moves - 1;
+		uint64_t flips = flipMask(own, opp, square);
+		collectPositions(opp ^ flips, own | flips | (1ULL << square), !blackToMove, plies - 1, seen, positions);
+	}
+}
+
+/*
+ * Searches every position of the first plies moves to the given depth and returns the results sorted by key,
+ * ready to be written as the TABLE_BOOK section.
+ */
+void buildBook(int plies, int depth, std::vector<BookEntry> &book) {
+	std::set<uint64_t> seen;
+	std::vector<uint64_t> positions;
+	collectPositions(0x0000000810000000ULL, 0x0000001008000000ULL, true, plies, seen, positions);
+
+	Player *players[2] = {new Player(BLACK, BOOK_TABLE_KB), new Player(WHITE, BOOK_TABLE_KB)};
+	book.clear();
+	for (unsigned int i = 0; i < positions.size(); i += 2) {
+		uint64_t own = positions[i], opp = positions[i + 1];
+		bool blackToMove = (popCount(own | opp) % 2 == 0); //no passes this early
+		Player *player = players[blackToMove ? 0 : 1];
+		Board board;
+		board.setBits(blackToMove ? own : opp, blackToMove ? opp : own);
+
+		Move *move = NULL;
+		for (int d = 1; d <= depth; d++) {
+			delete move;
+			move = player->getBestMove(&board, d, INT_MIN, INT_MAX, true);
+		}
+		BookEntry entry;
+		int symmetry;
+		entry.key = canonicalHash(board.getBlackBits(), board.getWhiteBits(), blackToMove, symmetry);
+		entry.move = transformSquare(symmetry, move->getX() + 8 * move->getY());
+		entry.score = player->getBestScore(&board, depth, INT_MIN, INT_MAX, true); //answered by the table
+		entry.depth = depth;
+		entry.reserved = 0;
+		book.push_back(entry);
+		delete move;
+	}
+	delete players[0];
+	delete players[1];
+	std::sort(book.begin(), book.end(), entryLess);
+}
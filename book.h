@@ -0,0 +1,42 @@
+#ifndef __BOOK_H__
+#define __BOOK_H__
+
+#include <cstddef>
+#include <stdint.h>
+#include <vector>
+#include "tables.h"
+using namespace std;
+
+/*
+ * One opening book position, keyed by canonicalHash so that all 8 symmetric forms share an entry. move is the
+ * book move in the canonical orientation; score is the search score for the side to move. The TABLE_BOOK section
+ * is an array of these sorted by key.
+ */
+struct BookEntry {
+	uint64_t key;
+	int32_t score;
+	uint8_t move;
+	uint8_t depth;
+	uint16_t reserved;
+};
+
+/*
+ * Read-only view of the book section of a mapped table file.
+ */
+class OpeningBook {
+
+private:
+	const BookEntry *entries;
+	size_t numEntries;
+
+public:
+	OpeningBook();
+
+	bool attach(const SharedTables &tables);
+	size_t size() const;
+	bool find(uint64_t black, uint64_t white, bool blackToMove, int &square, int &score) const;
+};
+
+void buildBook(int plies, int depth, std::vector<BookEntry> &book);
+
+#endif
@@ -0,0 +1,46 @@
+#include <iostream>
+#include <cstdlib>
+#include <csignal>
+#include <thread>
+#include "server.h"
+using namespace std;
+
+static EngineServer *server = NULL;
+
+static void handleSignal(int signal) {
+    server->stop();
+}
+
+int main(int argc, char *argv[]) {
+    // Socket to listen on, and how many games to search at once.
+    if (argc != 2 && argc != 3) {
+        cerr << "usage: " << argv[0] << " socket [workers]" << endl;
+        exit(-1);
+    }
+    int workers = (argc == 3) ? atoi(argv[2]) : max(1u, thread::hardware_concurrency());
+    const char *tableKB = getenv("STATESALESTAX_HASH_KB");
+    size_t sessionTableKB = (tableKB != NULL) ? atoi(tableKB) : SERVER_TABLE_KB;
+
+    // The table file is mapped once for all games, and checked in full
+    // since that happens only once.
+    SharedTables tables;
+    const char *tablesFile = getenv("STATESALESTAX_TABLES");
+    bool haveTables = tables.map((tablesFile != NULL) ? tablesFile : TABLE_DEFAULT_PATH) && tables.verify();
+    if (!haveTables && (tablesFile != NULL || tables.isMapped())) {
+        cerr << tables.error << endl;
+    }
+
+    server = new EngineServer(argv[1], workers, sessionTableKB, haveTables ? &tables : NULL);
+    if (!server->listen()) {
+        exit(-1);
+    }
+    signal(SIGINT, handleSignal);
+    signal(SIGTERM, handleSignal);
+    cerr << "Serving games on " << argv[1] << " with " << workers << " workers" << endl;
+
+    // Runs until SIGINT or SIGTERM; games in progress are lost.
+    server->run();
+    cerr << server->sessionsServed << " sessions served" << endl;
+    delete server;
+    return 0;
+}
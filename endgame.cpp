@@ -0,0 +1,273 @@
+#include <algorithm>
+#include <thread>
+#include "bitboard.h"
+#include "endgame.h"
+
+#define SPLIT_MIN_EMPTIES 9 //smaller subtrees are searched by one thread
+#define ORDER_MIN_EMPTIES 6 //below this, sorting moves costs more than it saves
+#define ABORT_CHECK_EMPTIES 5 //serial nodes this deep look for cutoffs and stop requests
+#define SCORE_INFINITY 65
+
+/*
+ * Sorts the moves in the mask so that moves leaving the opponent fewest replies come first (fastest-first),
+ * which tends to find cutoffs early. Returns the number of moves.
+ */
+static int orderMoves(uint64_t own, uint64_t opp, uint64_t moves, int *list, bool sort) {
+	int keys[32];
+	int n = 0;
+	while (moves) {
+		int square = firstSquare(moves);
+		moves &= moves - 1;
+		int key = 0;
+		if (sort) {
+			uint64_t flips = flipMask(own, opp, square);
+			key = popCount(legalMoveMask(opp ^ flips, own | flips | (1ULL << square)));
+			if ((1ULL << square) & CORNERS)
+				key -= 2;
+		}
+		int i = n++;
+		for (; i > 0 && keys[i - 1] > key; i--) {
+			keys[i] = keys[i - 1];
+			list[i] = list[i - 1];
+		}
+		keys[i] = key;
+		list[i] = square;
+	}
+	return n;
+}
+
+/*
+ * threads is the number of threads a solve uses, counting the calling one. The others are started here and kept;
+ * if not all of them can be started, the solver uses fewer.
+ */
+EndgameSolver::EndgameSolver(int threads) : pool(std::max(threads, 1) - 1) {
+	numThreads = pool.size() + 1;
+	for (int i = 0; i < numThreads; i++) {
+		workers.push_back(new Worker());
+		workers[i]->seed = 12345 + 7919 * i;
+	}
+	stopFlag = NULL;
+	nodes = 0;
+}
+
+EndgameSolver::~EndgameSolver() {
+	for (unsigned int i = 0; i < workers.size(); i++)
+		delete workers[i];
+}
+
+/*
+ * While *flag is set, solving stops as soon as possible and its result is meaningless.
+ */
+void EndgameSolver::setStopFlag(std::atomic<bool> *flag) {
+	stopFlag = flag;
+}
+
+int EndgameSolver::getThreads() {
+	return numThreads;
+}
+
+/*
+ * The solver's helper threads, for other searches to borrow between solves.
+ */
+ThreadPool *EndgameSolver::getPool() {
+	return &pool;
+}
+
+/*
+ * Returns the final disc difference (own minus opp) with the side owning own to move, and its best move in
+ * bestMove (-1 if it has to pass).
+ */
+int EndgameSolver::solve(uint64_t own, uint64_t opp, int &bestMove) {
+	finished = false;
+	for (int i = 0; i < numThreads; i++)
+		workers[i]->nodes = 0;
+	pool.start([this](int helper) { helperLoop(workers[helper]); });
+
+	bestMove = -1;
+	int score = search(*workers[0], own, opp, -SCORE_INFINITY, SCORE_INFINITY, NULL, &bestMove);
+
+	finished = true;
+	pool.wait();
+	nodes = 0;
+	for (int i = 0; i < numThreads; i++)
+		nodes += workers[i]->nodes;
+	return score;
+}
+
+/*
+ * True if the search below sp is no longer wanted: a split point on the way up has been cut off, or the solve
+ * has been told to stop.
+ */
+bool EndgameSolver::aborted(const SplitPoint *sp) {
+	if (stopFlag != NULL && stopFlag->load(std::memory_order_relaxed))
+		return true;
+	for (; sp != NULL; sp = sp->parent)
+		if (sp->cutoff.load(std::memory_order_relaxed))
+			return true;
+	return false;
+}
+
+/*
+ * Negamax search that may split. parent is the nearest split point above this node, if any.
+ */
+int EndgameSolver::search(Worker &w, uint64_t own, uint64_t opp, int alpha, int beta, SplitPoint *parent,
+		int *bestMove) {
+	int empties = popCount(~(own | opp));
+	if (empties <= SPLIT_MIN_EMPTIES)
+		return searchSerial(w, own, opp, alpha, beta, parent, bestMove);
+	w.nodes++;
+	if (aborted(parent))
+		return 0;
+
+	uint64_t moves = legalMoveMask(own, opp);
+	if (moves == 0) {
+		if (legalMoveMask(opp, own) == 0)
+			return popCount(own) - popCount(opp);
+		return -search(w, opp, own, -beta, -alpha, parent, NULL); //pass
+	}
+	int list[32];
+	int n = orderMoves(own, opp, moves, list, true);
+
+	//the eldest brother is searched alone first
+	uint64_t flips = flipMask(own, opp, list[0]);
+	int best = -search(w, opp ^ flips, own | flips | (1ULL << list[0]), -beta, -alpha, parent, NULL);
+	if (bestMove != NULL)
+		*bestMove = list[0];
+	if (best >= beta || n == 1 || aborted(parent))
+		return best;
+	alpha = std::max(alpha, best);
+
+	//then the rest are offered to other threads
+	SplitPoint sp;
+	sp.beta = beta;
+	sp.alpha = alpha;
+	sp.best = best;
+	sp.bestMove = list[0];
+	sp.pending = n - 1;
+	sp.cutoff = false;
+	sp.parent = parent;
+	{
+		std::lock_guard<std::mutex> lock(w.lock);
+		for (int i = n - 1; i >= 1; i--) {
+			Task task;
+			task.splitPoint = &sp;
+			task.move = list[i];
+			flips = flipMask(own, opp, list[i]);
+			task.own = opp ^ flips;
+			task.opp = own | flips | (1ULL << list[i]);
+			w.tasks.push_back(task);
+		}
+	}
+	while (sp.pending.load() > 0) {
+		Task task;
+		if (popTask(w, task) || stealTask(w, task))
+			runTask(w, task);
+		else
+			std::this_thread::yield();
+	}
+	if (bestMove != NULL)
+		*bestMove = sp.bestMove;
+	return sp.best;
+}
+
+/*
+ * Plain negamax search near the leaves, where splitting would cost more than it gains.
+ */
+int EndgameSolver::searchSerial(Worker &w, uint64_t own, uint64_t opp, int alpha, int beta, SplitPoint *parent,
+		int *bestMove) {
+	w.nodes++;
+	int empties = popCount(~(own | opp));
+	if (empties >= ABORT_CHECK_EMPTIES && aborted(parent))
+		return 0;
+
+	uint64_t moves = legalMoveMask(own, opp);
+	if (moves == 0) {
+		if (legalMoveMask(opp, own) == 0)
+			return popCount(own) - popCount(opp);
+		return -searchSerial(w, opp, own, -beta, -alpha, parent, NULL); //pass
+	}
+	int list[32];
+	int n = orderMoves(own, opp, moves, list, empties > ORDER_MIN_EMPTIES);
+	int best = -SCORE_INFINITY;
+	for (int i = 0; i < n; i++) {
+		uint64_t flips = flipMask(own, opp, list[i]);
+		int score = -searchSerial(w, opp ^ flips, own | flips | (1ULL << list[i]), -beta, -alpha, parent, NULL);
+		if (score > best) {
+			best = score;
+			if (bestMove != NULL)
+				*bestMove = list[i];
+			alpha = std::max(alpha, score);
+			if (alpha >= beta)
+				break;
+		}
+	}
+	return best;
+}
+
+/*
+ * Searches one child of a split point with the split point's current window and reports back.
+ */
+void EndgameSolver::runTask(Worker &w, const Task &task) {
+	SplitPoint *sp = task.splitPoint;
+	if (!aborted(sp)) {
+		int alpha;
+		{
+			std::lock_guard<std::mutex> lock(sp->lock);
+			alpha = sp->alpha;
+		}
+		int score = -search(w, task.own, task.opp, -sp->beta, -alpha, sp, NULL);
+		if (!aborted(sp)) {
+			std::lock_guard<std::mutex> lock(sp->lock);
+			if (score > sp->best) {
+				sp->best = score;
+				sp->bestMove = task.move;
+			}
+			sp->alpha = std::max(sp->alpha, score);
+			if (score >= sp->beta)
+				sp->cutoff = true;
+		}
+	}
+	sp->pending.fetch_sub(1); //sp may be gone after this
+}
+
+bool EndgameSolver::popTask(Worker &w, Task &task) {
+	std::lock_guard<std::mutex> lock(w.lock);
+	if (w.tasks.empty())
+		return false;
+	task = w.tasks.back();
+	w.tasks.pop_back();
+	return true;
+}
+
+/*
+ * Takes the oldest task of some other thread, trying every thread once from a random starting point.
+ */
+bool EndgameSolver::stealTask(Worker &w, Task &task) {
+	w.seed = w.seed * 1103515245 + 12345;
+	int start = (w.seed >> 16) % numThreads;
+	for (int i = 0; i < numThreads; i++) {
+		Worker *victim = workers[(start + i) % numThreads];
+		if (victim == &w)
+			continue;
+		std::lock_guard<std::mutex> lock(victim->lock);
+		if (victim->tasks.empty())
+			continue;
+		task = victim->tasks.front();
+		victim->tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+/*
+ * What the other threads do during a solve: steal and run tasks until the root search is done.
+ */
+void EndgameSolver::helperLoop(Worker *w) {
+	while (!finished.load()) {
+		Task task;
+		if (stealTask(*w, task))
+			runTask(*w, task);
+		else
+			std::this_thread::yield();
+	}
+}
@@ -0,0 +1,84 @@
+#ifndef __ENDGAME_H__
+#define __ENDGAME_H__
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+#include "threadpool.h"
+using namespace std;
+
+/*
+ * A node whose remaining children are being searched in parallel. The first child is always searched before the
+ * node splits, so that its score can narrow the window for (or cut off) the rest. Lives on the stack of the thread
+ * that split it, which waits (helping with other tasks) until pending drops to zero.
+ */
+struct SplitPoint {
+	int beta;
+	std::mutex lock; //guards alpha, best and bestMove
+	int alpha;
+	int best;
+	int bestMove;
+	std::atomic<int> pending; //children not finished yet
+	std::atomic<bool> cutoff; //set once a child scores >= beta; its siblings stop
+	SplitPoint *parent;
+};
+
+/*
+ * One child of a split point to search. Carries the child position itself, from the point of view of the side to
+ * move there.
+ */
+struct Task {
+	SplitPoint *splitPoint;
+	uint64_t own;
+	uint64_t opp;
+	int move;
+};
+
+/*
+ * Per-thread state. The owner pushes and pops tasks at the back of its deque; other threads steal from the front,
+ * which holds the children that were ordered last and carry the least urgent work.
+ */
+struct Worker {
+	std::mutex lock;
+	std::deque<Task> tasks;
+	unsigned long long nodes;
+	unsigned int seed;
+};
+
+/*
+ * Exact endgame solver: finds the final disc difference under perfect play with a parallel alpha-beta search on
+ * bitboards, using Young Brothers Wait splitting and work stealing.
+ */
+class EndgameSolver {
+
+private:
+	ThreadPool pool;
+	int numThreads;
+	std::vector<Worker*> workers;
+	std::atomic<bool> finished;
+	std::atomic<bool> *stopFlag;
+
+	bool aborted(const SplitPoint *sp);
+	int search(Worker &w, uint64_t own, uint64_t opp, int alpha, int beta, SplitPoint *parent, int *bestMove);
+	int searchSerial(Worker &w, uint64_t own, uint64_t opp, int alpha, int beta, SplitPoint *parent,
+		int *bestMove);
+	void runTask(Worker &w, const Task &task);
+	bool popTask(Worker &w, Task &task);
+	bool stealTask(Worker &w, Task &task);
+	void helperLoop(Worker *w);
+
+public:
+	EndgameSolver(int threads);
+	~EndgameSolver();
+
+	int solve(uint64_t own, uint64_t opp, int &bestMove);
+	void setStopFlag(std::atomic<bool> *flag);
+	int getThreads();
+	ThreadPool *getPool();
+
+	unsigned long long nodes; //nodes searched by the last solve
+};
+
+#endif
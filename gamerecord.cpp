@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gamerecord.h"
+
+#define READ_BUFFER_SIZE (1 << 20)
+
+GameRecord::GameRecord() {
+	clear();
+}
+
+void GameRecord::clear() {
+	engineBlack = false;
+	mcts = false;
+	searchDepth = 0;
+	tableSizeLog2 = 0;
+	options = 0;
+	finalScore = 0;
+	moves.clear();
+	info.clear();
+}
+
+static void putU16(std::vector<unsigned char> &out, unsigned int v) {
+	out.push_back(v & 0xff);
+	out.push_back((v >> 8) & 0xff);
+}
+
+static void putU32(std::vector<unsigned char> &out, unsigned int v) {
+	putU16(out, v & 0xffff);
+	putU16(out, (v >> 16) & 0xffff);
+}
+
+static unsigned int getU16(const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static unsigned int getU32(const unsigned char *p) {
+	return getU16(p) | (getU16(p + 2) << 16);
+}
+
+/*
+ * Appends the binary form of a record to out.
+ */
+void encodeRecord(const GameRecord &record, std::vector<unsigned char> &out) {
+	out.push_back('O');
+	out.push_back('R');
+	out.push_back('E');
+	out.push_back('C');
+	out.push_back(RECORD_VERSION);
+	out.push_back((record.engineBlack ? RECORD_ENGINE_BLACK : 0) | (record.mcts ? RECORD_ENGINE_MCTS : 0));
+	out.push_back(record.searchDepth);
+	out.push_back(record.tableSizeLog2);
+	out.push_back(record.options);
+	out.push_back((unsigned char) (signed char) record.finalScore);
+	putU16(out, record.moves.size());
+	putU16(out, record.info.size());
+	putU16(out, 0);
+	out.insert(out.end(), record.moves.begin(), record.moves.end());
+	for (unsigned int i = 0; i < record.info.size(); i++) {
+		const MoveInfo &info = record.info[i];
+		int score = std::max(-32768, std::min(32767, info.score));
+		putU32(out, (unsigned int) info.msLeft);
+		putU32(out, info.timeMs);
+		putU32(out, info.nodes);
+		out.push_back(info.depth);
+		putU16(out, (unsigned int) score & 0xffff);
+	}
+}
+
+
+/*
+ *
+ * CHECKPOINTS
+ *
+ */
+
+
+static std::atomic<CheckpointFile *> checkpoints[CHECKPOINT_SLOTS];
+
+CheckpointFile::CheckpointFile(const char *path) : path(path), current(-1), state(CHECKPOINT_PENDING) {
+	sizes[0] = sizes[1] = 0;
+	for (int i = 0; i < CHECKPOINT_SLOTS; i++) {
+		CheckpointFile *empty = NULL;
+		if (checkpoints[i].compare_exchange_strong(empty, this))
+			break;
+	}
+}
+
+CheckpointFile::~CheckpointFile() {
+	for (int i = 0; i < CHECKPOINT_SLOTS; i++) {
+		CheckpointFile *self = this;
+		checkpoints[i].compare_exchange_strong(self, NULL);
+	}
+}
+
+/*
+ * Replaces the bytes to be written. Contents larger than CHECKPOINT_MAX_SIZE are dropped, keeping the last ones
+ * that fit.
+ */
+void CheckpointFile::update(const void *data, size_t size) {
+	if (size > CHECKPOINT_MAX_SIZE)
+		return;
+	int next = (current.load() == 0) ? 1 : 0;
+	memcpy(buffers[next], data, size);
+	sizes[next] = size;
+	current.store(next);
+}
+
+/*
+ * Appends the latest bytes to the file, unless that has already been done or is being done. Only uses calls that
+ * are safe in a signal handler. Returns false if the file could not be written.
+ */
+bool CheckpointFile::write() {
+	int expected = CHECKPOINT_PENDING;
+	if (!state.compare_exchange_strong(expected, CHECKPOINT_WRITING))
+		return true;
+	int c = current.load();
+	bool ok = true;
+	if (c >= 0) {
+		int fd = open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT, 0644);
+		ok = fd >= 0 && ::write(fd, buffers[c], sizes[c]) == (ssize_t) sizes[c];
+		if (fd >= 0)
+			close(fd);
+	}
+	state.store(CHECKPOINT_WRITTEN);
+	return ok;
+}
+
+bool CheckpointFile::isWriting() {
+	return state.load() == CHECKPOINT_WRITING;
+}
+
+/*
+ * Writes every checkpoint and dies of the signal, unless some other thread is already writing one at a normal end;
+ * then that end is left to finish.
+ */
+static void writeCheckpointsAndExit(int sig) {
+	bool busy = false;
+	for (int i = 0; i < CHECKPOINT_SLOTS; i++) {
+		CheckpointFile *checkpoint = checkpoints[i].load();
+		if (checkpoint != NULL) {
+			checkpoint->write();
+			busy |= checkpoint->isWriting();
+		}
+	}
+	if (busy)
+		return;
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+/*
+ * From now on SIGTERM and SIGINT write out the checkpoints before the process goes.
+ */
+void writeCheckpointsOnSignal() {
+	signal(SIGTERM, writeCheckpointsAndExit);
+	signal(SIGINT, writeCheckpointsAndExit);
+}
+
+
+/*
+ *
+ * WRITING
+ *
+ */
+
+
+GameRecorder::GameRecorder(const char *path, bool engineBlack, bool mcts, int searchDepth, int tableSizeLog2,
+		int options) : file(path) {
+	record.engineBlack = engineBlack;
+	record.mcts = mcts;
+	record.searchDepth = searchDepth;
+	record.tableSizeLog2 = tableSizeLog2;
+	record.options = options;
+	record.moves.reserve(128);
+	record.info.reserve(64);
+	finished = false;
+	checkpoint(0);
+}
+
+/*
+ * A game that ends without finish() being called (the player is deleted early) is written out as it stands. A
+ * process that is killed writes its last checkpoint() instead, if writeCheckpointsOnSignal() covers the signal;
+ * after SIGKILL nothing is written.
+ */
+GameRecorder::~GameRecorder() {
+	finish(record.finalScore);
+}
+
+/*
+ * Adds the next move of the game. A NULL move is a pass.
+ */
+void GameRecorder::addMove(Move *m) {
+	record.moves.push_back((m == NULL) ? RECORD_PASS : m->getX() + 8 * m->getY());
+}
+
+void GameRecorder::addInfo(const MoveInfo &info) {
+	record.info.push_back(info);
+}
+
+/*
+ * Keeps the record so far, with the given final score, ready to be written if the process is killed. Called
+ * between moves, never while one is being computed.
+ */
+void GameRecorder::checkpoint(int finalScore) {
+	record.finalScore = finalScore;
+	std::vector<unsigned char> out;
+	encodeRecord(record, out);
+	file.update(&out[0], out.size());
+}
+
+/*
+ * Appends the record to the file. Later calls do nothing, and neither does this one if a signal handler has
+ * already written the record.
+ */
+void GameRecorder::finish(int finalScore) {
+	if (finished)
+		return;
+	finished = true;
+	checkpoint(finalScore);
+	if (!file.write())
+		cerr << "could not write game record" << endl;
+}
+
+
+/*
+ *
+ * READING
+ *
+ */
+
+
+GameRecordReader::GameRecordReader(FILE *file) {
+	this->file = file;
+	buffer.resize(READ_BUFFER_SIZE);
+	pos = 0;
+	len = 0;
+	failed = false;
+}
+
+GameRecordReader::~GameRecordReader() {
+}
+
+/*
+ * Makes sure at least needed unread bytes are in the buffer, moving the unread tail to the front and reading more
+ * from the file if necessary. Returns false at end of file.
+ */
+bool GameRecordReader::fill(size_t needed) {
+	if (len - pos >= needed)
+		return true;
+	if (needed > buffer.size())
+		buffer.resize(needed);
+	memmove(&buffer[0], &buffer[pos], len - pos);
+	len -= pos;
+	pos = 0;
+	while (len < needed) {
+		size_t n = fread(&buffer[len], 1, buffer.size() - len, file);
+		if (n == 0)
+			return false;
+		len += n;
+	}
+	return true;
+}
+
+/*
+ * Reads the next record. Returns false at the end of the stream, or if the stream is damaged (then failed is set).
+ */
+bool GameRecordReader::next(GameRecord &record) {
+	if (failed)
+		return false;
+	if (!fill(RECORD_HEADER_SIZE)) {
+		failed = (len != pos); //trailing bytes that are not a whole header
+		return false;
+	}
+	const unsigned char *p = &buffer[pos];
+	if (memcmp(p, "OREC", 4) != 0 || p[4] != RECORD_VERSION) {
+		failed = true;
+		return false;
+	}
+	unsigned int numMoves = getU16(p + 10);
+	unsigned int numInfo = getU16(p + 12);
+	size_t size = RECORD_HEADER_SIZE + numMoves + numInfo * RECORD_INFO_SIZE;
+	if (!fill(size)) {
+		failed = true;
+		return false;
+	}
+
+	p = &buffer[pos];
+	record.engineBlack = (p[5] & RECORD_ENGINE_BLACK) != 0;
+	record.mcts = (p[5] & RECORD_ENGINE_MCTS) != 0;
+	record.searchDepth = p[6];
+	record.tableSizeLog2 = p[7];
+	record.options = p[8];
+	record.finalScore = (signed char) p[9];
+	p += RECORD_HEADER_SIZE;
+	record.moves.assign(p, p + numMoves);
+	p += numMoves;
+	record.info.resize(numInfo);
+	for (unsigned int i = 0; i < numInfo; i++, p += RECORD_INFO_SIZE) {
+		MoveInfo &info = record.info[i];
+		info.msLeft = (int) getU32(p);
+		info.timeMs = getU32(p + 4);
+		info.nodes = getU32(p + 8);
+		info.depth = p[12];
+		info.score = (short) getU16(p + 13);
+	}
+	pos += size;
+	return true;
+}
@@ -0,0 +1,148 @@
+#ifndef __GAMERECORD_H__
+#define __GAMERECORD_H__
+
+#include <atomic>
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "common.h"
+using namespace std;
+
+/*
+ * Binary game record. A record file is any number of records back to back, each laid out as (little-endian):
+ *
+ *   16-byte header
+ *      0  magic "OREC"
+ *      4  version
+ *      5  flags: bit 0 set if the engine played black, bit 1 set if it searched with MCTS
+ *      6  configured search depth, 0 for MCTS
+ *      7  transposition table size (log2 of entries)
+ *      8  search options: bit 0 table, bit 1 ETC, bit 2 symmetry, bit 3 endgame solver, bit 4 opening book,
+ *         bit 5 evaluation cache
+ *      9  final score: engine discs minus opponent discs, as of the last position the engine saw
+ *     10  number of moves (u16)
+ *     12  number of engine moves with search info (u16)
+ *     14  reserved
+ *   one byte per move, black first, alternating sides: square x + 8*y, or RECORD_PASS
+ *   15 bytes of search info per engine move: msLeft (i32), wall time in ms (u32), nodes (u32), depth (u8),
+ *     score (i16, clamped)
+ */
+
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 16
+#define RECORD_INFO_SIZE 15
+#define RECORD_PASS 64
+
+#define RECORD_ENGINE_BLACK 1
+#define RECORD_ENGINE_MCTS 2
+#define RECORD_USE_TABLE 1
+#define RECORD_USE_ETC 2
+#define RECORD_USE_SYMMETRY 4
+#define RECORD_USE_SOLVER 8
+#define RECORD_USE_BOOK 16
+#define RECORD_USE_EVAL_CACHE 32
+
+struct MoveInfo {
+	int msLeft;
+	unsigned int timeMs;
+	unsigned int nodes;
+	int depth;
+	int score;
+};
+
+struct GameRecord {
+	bool engineBlack;
+	bool mcts;
+	int searchDepth;
+	int tableSizeLog2;
+	int options;
+	int finalScore;
+	std::vector<unsigned char> moves;
+	std::vector<MoveInfo> info;
+
+	GameRecord();
+	void clear();
+};
+
+#define CHECKPOINT_MAX_SIZE 4096
+#define CHECKPOINT_SLOTS 4 //checkpoints the signal handler knows about; more are only written at a normal end
+
+enum CheckpointState {
+	CHECKPOINT_PENDING, CHECKPOINT_WRITING, CHECKPOINT_WRITTEN
+};
+
+/*
+ * Bytes to be appended to a file once, either at a normal end or, if writeCheckpointsOnSignal() was called, from
+ * the handler of a signal that kills the process first (the Java framework closes our streams and sends SIGTERM
+ * right away, before a normal end can happen). update() replaces the bytes; they are kept in two fixed buffers
+ * so that the handler always finds a complete copy and never allocates.
+ */
+class CheckpointFile {
+
+private:
+	std::string path;
+	char buffers[2][CHECKPOINT_MAX_SIZE];
+	size_t sizes[2];
+	std::atomic<int> current; //buffer with the latest bytes, -1 before the first update
+	std::atomic<int> state;
+
+public:
+	CheckpointFile(const char *path);
+	~CheckpointFile();
+
+	void update(const void *data, size_t size);
+	bool write();
+	bool isWriting();
+};
+
+void writeCheckpointsOnSignal();
+
+/*
+ * Builds one record in memory while the game is played. checkpoint() keeps a copy ready to be written if the
+ * process is killed, and finish() appends the record to the file in a single write, so that nothing touches the
+ * disk while a move is being computed.
+ */
+class GameRecorder {
+
+private:
+	CheckpointFile file;
+	GameRecord record;
+	bool finished;
+
+public:
+	GameRecorder(const char *path, bool engineBlack, bool mcts, int searchDepth, int tableSizeLog2, int options);
+	~GameRecorder();
+
+	void addMove(Move *m);
+	void addInfo(const MoveInfo &info);
+	void checkpoint(int finalScore);
+	void finish(int finalScore);
+};
+
+/*
+ * Reads records one at a time from a stream through a large buffer.
+ */
+class GameRecordReader {
+
+private:
+	FILE *file;
+	std::vector<unsigned char> buffer;
+	size_t pos;
+	size_t len;
+
+	bool fill(size_t needed);
+
+public:
+	GameRecordReader(FILE *file);
+	~GameRecordReader();
+
+	// set once the stream has ended inside a record or held something that is not a record
+	bool failed;
+
+	bool next(GameRecord &record);
+};
+
+void encodeRecord(const GameRecord &record, std::vector<unsigned char> &out);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef __GEOMETRY_H__
+#define __GEOMETRY_H__
+
+#include <stdint.h>
+
+/*
+ * Fixed facts about the squares of the board: edge and corner masks, the 8 directions, and per-square tables
+ * worked out by the compiler from them (which squares lie in each direction from a square, which are next to it
+ * and which lines run through it). Square (x, y) is bit x + 8*y, the same indexing Board uses for its bitsets.
+ */
+
+#define NOT_LEFT_EDGE 0xfefefefefefefefeULL //every square but x == 0
+#define NOT_RIGHT_EDGE 0x7f7f7f7f7f7f7f7fULL //every square but x == 7
+#define EDGE_COLUMNS 0x8181818181818181ULL //x == 0 or x == 7
+#define EDGE_ROWS 0xff000000000000ffULL //y == 0 or y == 7
+#define EDGES (EDGE_COLUMNS | EDGE_ROWS)
+#define CORNERS 0x8100000000000081ULL
+
+/*
+ * Moves every square one step in a direction. Shifts that change x drop the squares that would wrap around to
+ * the other side of the board.
+ */
+constexpr uint64_t shiftEast(uint64_t b) { return (b << 1) & NOT_LEFT_EDGE; }
+constexpr uint64_t shiftWest(uint64_t b) { return (b >> 1) & NOT_RIGHT_EDGE; }
+constexpr uint64_t shiftSouth(uint64_t b) { return b << 8; }
+constexpr uint64_t shiftNorth(uint64_t b) { return b >> 8; }
+constexpr uint64_t shiftSouthEast(uint64_t b) { return (b << 9) & NOT_LEFT_EDGE; }
+constexpr uint64_t shiftSouthWest(uint64_t b) { return (b << 7) & NOT_RIGHT_EDGE; }
+constexpr uint64_t shiftNorthEast(uint64_t b) { return (b >> 7) & NOT_LEFT_EDGE; }
+constexpr uint64_t shiftNorthWest(uint64_t b) { return (b >> 9) & NOT_RIGHT_EDGE; }
+
+/*
+ * The directions towards higher squares come first, so that d < 4 tells which end of a ray is nearest.
+ */
+enum Direction {
+	EAST, SOUTH, SOUTH_EAST, SOUTH_WEST, WEST, NORTH, NORTH_EAST, NORTH_WEST
+};
+
+constexpr uint64_t shift(int direction, uint64_t b) {
+	return direction == EAST ? shiftEast(b) : direction == SOUTH ? shiftSouth(b)
+		: direction == SOUTH_EAST ? shiftSouthEast(b) : direction == SOUTH_WEST ? shiftSouthWest(b)
+		: direction == WEST ? shiftWest(b) : direction == NORTH ? shiftNorth(b)
+		: direction == NORTH_EAST ? shiftNorthEast(b) : shiftNorthWest(b);
+}
+
+/*
+ * Squares outside b that are next to a square of b in any of the 8 directions.
+ */
+constexpr uint64_t neighbors(uint64_t b) {
+	uint64_t row = b | shiftEast(b) | shiftWest(b);
+	return (row | shiftNorth(row) | shiftSouth(row)) & ~b;
+}
+
+/*
+ * The four lines through a square, one per axis. A diagonal keeps x - y fixed, an anti-diagonal x + y.
+ */
+enum Line {
+	LINE_ROW, LINE_COLUMN, LINE_DIAGONAL, LINE_ANTI_DIAGONAL
+};
+
+struct Geometry {
+	uint64_t rays[8][64]; //squares past the square in each direction, up to the edge
+	uint64_t neighbors[64]; //the up to 8 squares next to the square
+	uint64_t lines[4][64]; //whole line through the square (the square included), by Line
+
+	constexpr Geometry() : rays(), neighbors(), lines() {
+		for (int square = 0; square < 64; square++) {
+			uint64_t bit = 1ULL << square;
+			for (int d = 0; d < 8; d++) {
+				for (uint64_t b = shift(d, bit); b != 0; b = shift(d, b))
+					rays[d][square] |= b;
+			}
+			neighbors[square] = ::neighbors(bit);
+			lines[LINE_ROW][square] = rays[EAST][square] | rays[WEST][square] | bit;
+			lines[LINE_COLUMN][square] = rays[SOUTH][square] | rays[NORTH][square] | bit;
+			lines[LINE_DIAGONAL][square] = rays[SOUTH_EAST][square] | rays[NORTH_WEST][square] | bit;
+			lines[LINE_ANTI_DIAGONAL][square] = rays[SOUTH_WEST][square] | rays[NORTH_EAST][square] | bit;
+		}
+	}
+};
+
+constexpr Geometry GEOMETRY;
+
+/*
+ * Disk-square weights used by the positional score.
+ */
+constexpr int SQUARE_WEIGHTS[64] = {
+	99, -8, 8, 6, 6, 8, -8, 99,
+	-8, -24, -4, -3, -3, -4, -24, -8,
+	8, -4, 7, 4, 4, 7, -4, 8,
+	6, -3, 4, 0, 0, 4, -3, 6,
+	6, -3, 4, 0, 0, 4, -3, 6,
+	8, -4, 7, 4, 4, 7, -4, 8,
+	-8, -24, -4, -3, -3, -4, -24, -8,
+	99, -4, 8, 6, 6, 8, -4, 99
+};
+
+#endif
@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cmath>
+#include "bitboard.h"
+#include "mcts.h"
+
+#define MCTS_BATCH 8 //playouts run at each leaf visit
+#define MCTS_EXPLORATION 0.8 //weight of the UCT exploration term; results are scaled to [0, 1]
+#define MCTS_MAX_PATH 130 //64 moves and as many passes, plus the root
+
+/*
+ * xorshift64*: fast, and good enough to pick random moves with.
+ */
+static inline uint64_t nextRandom(uint64_t &state) {
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Plays random moves to the end of the game, taking a corner whenever one is available. Returns 2, 1 or 0 half
+ * points for a win, draw or loss of the side owning own, which is to move.
+ */
+static int playout(uint64_t own, uint64_t opp, uint64_t &random) {
+	bool swapped = false;
+	while (true) {
+		uint64_t moves = legalMoveMask(own, opp);
+		if (moves == 0) {
+			if (legalMoveMask(opp, own) == 0)
+				break;
+			std::swap(own, opp); //pass
+			swapped = !swapped;
+			continue;
+		}
+		if (moves & CORNERS)
+			moves &= CORNERS;
+		for (int skip = (nextRandom(random) >> 32) % popCount(moves); skip > 0; skip--)
+			moves &= moves - 1;
+		int square = firstSquare(moves);
+		uint64_t flips = flipMask(own, opp, square);
+		uint64_t next = own | flips | (1ULL << square);
+		own = opp ^ flips;
+		opp = next;
+		swapped = !swapped;
+	}
+	int diff = popCount(own) - popCount(opp);
+	if (swapped)
+		diff = -diff;
+	return (diff > 0) ? 2 : (diff == 0) ? 1 : 0;
+}
+
+/*
+ * A search runs on the calling thread and every helper of threads, which may be shared with other searches that
+ * do not run at the same time.
+ */
+MctsSearch::MctsSearch(ThreadPool *threads) {
+	this->threads = threads;
+	pool = new MctsNode[MCTS_POOL_NODES];
+	poolUsed = 0;
+	playoutCount = 0;
+	stopFlag = NULL;
+	playouts = 0;
+	treeNodes = 0;
+	winRate = 0;
+}
+
+MctsSearch::~MctsSearch() {
+	delete[] pool;
+}
+
+/*
+ * While *flag is set, searching stops as soon as possible.
+ */
+void MctsSearch::setStopFlag(std::atomic<bool> *flag) {
+	stopFlag = flag;
+}
+
+/*
+ * Searches for timeMs milliseconds (no limit if negative) or until maxPlayouts playouts have run (no limit if 0),
+ * and returns the most visited move of the side owning own (x + 8*y), or -1 if it has to pass.
+ */
+int MctsSearch::search(uint64_t own, uint64_t opp, int timeMs, long long maxPlayouts) {
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+	if (timeMs >= 0)
+		deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeMs);
+	MctsNode &root = pool[0];
+	root.visits = 0;
+	root.wins = 0;
+	root.state = MCTS_LEAF;
+	root.move = -1;
+	poolUsed = 1;
+	playoutCount = 0;
+	winRate = 0;
+	if (!expand(root, own, opp)) {
+		playouts = 0;
+		treeNodes = 1;
+		return -1; //game over
+	}
+
+	threads->start([&](int helper) { searchLoop(own, opp, deadline, maxPlayouts, 7919 * helper); });
+	searchLoop(own, opp, deadline, maxPlayouts, 12345);
+	threads->wait();
+
+	int best = root.firstChild;
+	for (int i = root.firstChild; i < root.firstChild + root.numChildren; i++) {
+		if (pool[i].visits > pool[best].visits)
+			best = i;
+	}
+	if (pool[best].visits > 0)
+		winRate = pool[best].wins / (2.0 * pool[best].visits);
+	playouts = playoutCount;
+	treeNodes = std::min((int) poolUsed, MCTS_POOL_NODES);
+	return pool[best].move;
+}
+
+/*
+ * What every thread does during a search: descend to a leaf by UCT, expand it if it has been visited before, run
+ * a batch of playouts from it and add the results to every node on the way.
+ */
+void MctsSearch::searchLoop(uint64_t own, uint64_t opp, std::chrono::steady_clock::time_point deadline,
+		long long maxPlayouts, uint64_t seed) {
+	uint64_t random = seed * 0x9e3779b97f4a7c15ULL + 1;
+	int path[MCTS_MAX_PATH];
+	bool moverIsRoot[MCTS_MAX_PATH]; //whether the root's side to move made the move into the node
+	while (!(stopFlag != NULL && stopFlag->load(std::memory_order_relaxed))
+			&& !(maxPlayouts > 0 && playoutCount.load(std::memory_order_relaxed) >= maxPlayouts)
+			&& std::chrono::steady_clock::now() < deadline) {
+		uint64_t toMove = own, other = opp;
+		bool rootToMove = true;
+		int length = 0;
+		int index = 0;
+		pool[0].visits.fetch_add(MCTS_BATCH, std::memory_order_relaxed);
+		path[length] = 0;
+		moverIsRoot[length++] = false;
+
+		while (true) {
+			MctsNode &node = pool[index];
+			int state = node.state.load(std::memory_order_acquire);
+			if (state != MCTS_EXPANDED) {
+				//a leaf is expanded on its second visit, and the playouts start from one of its children
+				if (state != MCTS_LEAF || node.visits.load(std::memory_order_relaxed) <= MCTS_BATCH
+						|| !expand(node, toMove, other))
+					break;
+			}
+			index = selectChild(node);
+			MctsNode &child = pool[index];
+			child.visits.fetch_add(MCTS_BATCH, std::memory_order_relaxed);
+			if (child.move >= 0) {
+				uint64_t flips = flipMask(toMove, other, child.move);
+				uint64_t next = toMove | flips | (1ULL << child.move);
+				toMove = other ^ flips;
+				other = next;
+			} else {
+				std::swap(toMove, other);
+			}
+			path[length] = index;
+			moverIsRoot[length++] = rootToMove;
+			rootToMove = !rootToMove;
+		}
+
+		int points = 0; //for the side to move at the leaf
+		for (int i = 0; i < MCTS_BATCH; i++)
+			points += playout(toMove, other, random);
+		int rootPoints = rootToMove ? points : 2 * MCTS_BATCH - points;
+		for (int i = 0; i < length; i++) {
+			int nodePoints = moverIsRoot[i] ? rootPoints : 2 * MCTS_BATCH - rootPoints;
+			pool[path[i]].wins.fetch_add(nodePoints, std::memory_order_relaxed);
+		}
+		playoutCount.fetch_add(MCTS_BATCH, std::memory_order_relaxed);
+	}
+}
+
+/*
+ * The child with the best UCT value. Children nobody has visited yet come first, in order.
+ */
+int MctsSearch::selectChild(const MctsNode &node) {
+	double logVisits = std::log((double) std::max(node.visits.load(std::memory_order_relaxed), 1));
+	int best = node.firstChild;
+	double bestValue = -1;
+	for (int i = node.firstChild; i < node.firstChild + node.numChildren; i++) {
+		int visits = pool[i].visits.load(std::memory_order_relaxed);
+		if (visits == 0)
+			return i;
+		double value = pool[i].wins.load(std::memory_order_relaxed) / (2.0 * visits)
+			+ MCTS_EXPLORATION * std::sqrt(logVisits / visits);
+		if (value > bestValue) {
+			best = i;
+			bestValue = value;
+		}
+	}
+	return best;
+}
+
+/*
+ * Gives the node its children, one per move of the side owning own or a single pass. Returns false if the game is
+ * over, another thread is already expanding the node, or the pool is full; the node then stays a leaf.
+ */
+bool MctsSearch::expand(MctsNode &node, uint64_t own, uint64_t opp) {
+	uint64_t moves = legalMoveMask(own, opp);
+	if (moves == 0 && legalMoveMask(opp, own) == 0)
+		return false;
+	int count = (moves == 0) ? 1 : popCount(moves);
+	if (poolUsed.load(std::memory_order_relaxed) + count > MCTS_POOL_NODES)
+		return false;
+	int expected = MCTS_LEAF;
+	if (!node.state.compare_exchange_strong(expected, MCTS_EXPANDING))
+		return false;
+	int first = poolUsed.fetch_add(count);
+	if (first + count > MCTS_POOL_NODES) {
+		node.state.store(MCTS_LEAF);
+		return false;
+	}
+	for (int i = 0; i < count; i++) {
+		MctsNode &child = pool[first + i];
+		child.visits.store(0, std::memory_order_relaxed);
+		child.wins.store(0, std::memory_order_relaxed);
+		child.state.store(MCTS_LEAF, std::memory_order_relaxed);
+		child.numChildren = 0;
+		if (moves == 0) {
+			child.move = -1;
+		} else {
+			child.move = firstSquare(moves);
+			moves &= moves - 1;
+		}
+	}
+	node.firstChild = first;
+	node.numChildren = count;
+	node.state.store(MCTS_EXPANDED, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef __MCTS_H__
+#define __MCTS_H__
+
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <vector>
+#include "threadpool.h"
+using namespace std;
+
+#define MCTS_POOL_NODES (1 << 20) //20 MB of nodes; once they run out, leaves stop being expanded
+
+/*
+ * One node of the search tree. Nodes live in a pool and refer to each other by index, never by pointer; the
+ * children of a node are consecutive. visits is raised by the playouts headed through a node before they are run
+ * (which counts them as losses in the meantime: the virtual loss that spreads threads over the tree), and wins by
+ * their results afterwards, in half points for the side that moved into the node.
+ */
+struct MctsNode {
+	std::atomic<int> visits;
+	std::atomic<int> wins;
+	std::atomic<int> state; //MCTS_LEAF, MCTS_EXPANDING or MCTS_EXPANDED
+	int firstChild; //valid once state is MCTS_EXPANDED
+	int8_t numChildren;
+	int8_t move; //square played to get here, -1 for a pass
+};
+
+enum MctsState {
+	MCTS_LEAF, MCTS_EXPANDING, MCTS_EXPANDED
+};
+
+/*
+ * Monte Carlo tree search with UCT selection. Each visit to a leaf runs a batch of random playouts on bitboards;
+ * several threads share the tree.
+ */
+class MctsSearch {
+
+private:
+	ThreadPool *threads;
+	MctsNode *pool;
+	std::atomic<int> poolUsed;
+	std::atomic<long long> playoutCount;
+	std::atomic<bool> *stopFlag;
+
+	void searchLoop(uint64_t own, uint64_t opp, std::chrono::steady_clock::time_point deadline,
+		long long maxPlayouts, uint64_t seed);
+	int selectChild(const MctsNode &node);
+	bool expand(MctsNode &node, uint64_t own, uint64_t opp);
+
+public:
+	MctsSearch(ThreadPool *threads);
+	~MctsSearch();
+
+	int search(uint64_t own, uint64_t opp, int timeMs, long long maxPlayouts);
+	void setStopFlag(std::atomic<bool> *flag);
+
+	// Results of the last search.
+	long long playouts;
+	int treeNodes;
+	double winRate; //of the move chosen, for the side to move
+};
+
+#endif
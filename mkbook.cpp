@@ -0,0 +1,32 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "book.h"
+#include "tables.h"
+
+// Builds the shared table file: searches every opening position up to the given number of moves and writes the
+// results as its book section.
+//
+// usage: mkbook [file] [plies] [depth]
+
+int main(int argc, char *argv[]) {
+    const char *path = (argc > 1) ? argv[1] : TABLE_DEFAULT_PATH;
+    int plies = (argc > 2) ? atoi(argv[2]) : 6;
+    int depth = (argc > 3) ? atoi(argv[3]) : 8;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<BookEntry> book;
+    buildBook(plies, depth, book);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    TableFileWriter writer;
+    writer.addSection(TABLE_BOOK, book.empty() ? NULL : &book[0], book.size() * sizeof(BookEntry));
+    if (!writer.write(path)) {
+        perror(path);
+        return 1;
+    }
+    printf("%s: %lu book positions (first %d moves, depth %d) in %.1f s\n", path, (unsigned long) book.size(),
+        plies, depth, seconds);
+    return 0;
+}
@@ -1,15 +1,48 @@
 #include "player.h"
 
 #define SCALE_CONSTANT 1000
+#define SEARCH_DEPTH 6
+#define CORNER_MOBILITY_WEIGHT 4 //a move onto a corner counts as this many moves
+#define SYMMETRY_EMPTIES 20 //getScore is pure stone parity from here on
+#define EVAL_CACHE_EMPTIES 20 //stone parity is cheaper than a cache lookup, so it is never cached
+#define ETC_MIN_DEPTH 4 //below this, probing every child costs more than it saves
+#define ENDGAME_EMPTIES 14 //from here on, doMove finishes with an exact solve
+#define MCTS_UNTIMED_PLAYOUTS 200000 //MCTS playouts per move when there is no clock
+#define SAFETY_MS 50 //time left untouched for the protocol and the java side
 
 /*
  * Constructor for the player; initialize everything here. The side your AI is
  * on (BLACK or WHITE) is passed in as "side". The constructor must finish 
- * within 30 seconds.
+ * within 30 seconds. tableKB sizes the transposition table, and 
+ * solverThreads (0 for defaultThreads()) the endgame solver and the
+ * MCTS engine; engine picks the search doMove uses.
  */
-Player::Player(Side side) {
+Player::Player(Side side, size_t tableKB, int solverThreads, Engine engine) : table(tableKB),
+        solver(solverThreads > 0 ? solverThreads : defaultThreads()),
+        evalCache(EVAL_CACHE_LOG2) {
     // Will be set to true in test_minimax.cpp.
     testingMinimax = false;
+    
+    useTable = true;
+    useETC = true;
+    useSymmetry = false;
+    useSolver = true;
+    useEvalCache = false; //slower than evaluating since the evaluation went to bitboards; see testevalcache
+    useBook = true;
+    nodes = 0;
+    recorder = NULL;
+    firstMove = true;
+    lastScore = 0;
+    turn = 0;
+    bestSquare = -1;
+    stopRequested = false;
+    solver.setStopFlag(&stopRequested);
+    this->engine = engine;
+    mcts = NULL;
+    if (engine == ENGINE_MCTS) {
+        mcts = new MctsSearch(solver.getPool()); //the solver never runs at the same time
+        mcts->setStopFlag(&stopRequested);
+    }
 
     /* 
      * TODO: Do any initialization you need to do here (setting up the board,
@@ -30,8 +63,50 @@ Player::Player(Side side) {
  * Destructor for the player.
  */
 Player::~Player() {
+    if (recorder != NULL) {
+        recorder->finish(getStoneParity(board));
+        delete recorder;
+    }
+    delete mcts;
 }
 
+/*
+ * Takes the opening book from a mapped table file, which must stay mapped as long as this player is used.
+ */
+void Player::setTables(const SharedTables * tables) {
+    book.attach(*tables);
+}
+
+/*
+ * Resizes (and empties) the transposition table; sizeKB is capped at TABLE_MAX_KB.
+ */
+void Player::setTableSize(size_t sizeKB) {
+    table.resize(sizeKB);
+}
+
+/*
+ * Appends a record of this game to the given file when the player is destroyed, or from the signal handler of 
+ * writeCheckpointsOnSignal() with the game up to the last checkpointRecord().
+ */
+void Player::recordTo(const char * path) {
+    int options = (useTable ? RECORD_USE_TABLE : 0) | (useETC ? RECORD_USE_ETC : 0) 
+        | (useSymmetry ? RECORD_USE_SYMMETRY : 0) | (useSolver ? RECORD_USE_SOLVER : 0) 
+        | (useBook ? RECORD_USE_BOOK : 0) | (useEvalCache ? RECORD_USE_EVAL_CACHE : 0);
+    bool mctsGame = (engine == ENGINE_MCTS);
+    delete recorder;
+    recorder = new GameRecorder(path, playerSide == BLACK, mctsGame, mctsGame ? 0 : SEARCH_DEPTH, 
+        table.sizeLog2(), options);
+}
+
+
+/*
+ * Brings the copy of the game record that a signal handler would write up to date. Call it between moves, once 
+ * the reply has been sent.
+ */
+void Player::checkpointRecord() {
+    if (recorder != NULL)
+        recorder->checkpoint(getStoneParity(board));
+}
 
 /*
  * Compute the next move given the opponent's last move. Your AI is
@@ -46,21 +121,215 @@ Player::~Player() {
  * return NULL.
  */
 Move* Player::doMove(Move *opponentsMove, int msLeft) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long startNodes = nodes;
+    int timeLimit = getTimeLimit(msLeft);
+    
+    //black's first call has no opponent's move; any other NULL is a pass
+    if (recorder != NULL && !(firstMove && playerSide == BLACK))
+        recorder->addMove(opponentsMove);
+    firstMove = false;
+    
     board->doMove(opponentsMove, otherSide); //make opponent's move on the board
-    Move* selectedMove = getBestMove(board, 6, INT_MIN, INT_MAX, true); //using minimax to find best move
+    table.newSearch();
+    int empties = board->countEmpty();
+    timing.startMove(empties);
+    
+    //until an iteration completes, any legal move will do
+    std::vector<Move*> legalMoves = getLegalMoves(board, playerSide);
+    {
+        std::lock_guard<std::mutex> lock(searchLock);
+        bestSquare = legalMoves.empty() ? -1 : legalMoves[0]->getX() + 8 * legalMoves[0]->getY();
+        stopRequested = false;
+        turn++;
+    }
+    searchReady.notify_all();
+    bool canMove = !legalMoves.empty();
+    for (unsigned int i = 0; i < legalMoves.size(); i++)
+        delete legalMoves[i];
+    
+    //book positions are played at once; a book move that is not legal here means a damaged file
+    int bookSquare, bookScore;
+    bool inBook = canMove && useBook && !testingMinimax
+        && book.find(board->getBlackBits(), board->getWhiteBits(), playerSide == BLACK, bookSquare, bookScore);
+    if (inBook) {
+        Move bookMove(bookSquare % 8, bookSquare / 8);
+        inBook = board->checkMove(&bookMove, playerSide);
+    }
+    if (inBook) {
+        std::lock_guard<std::mutex> lock(searchLock);
+        if (!stopRequested) {
+            bestSquare = bookSquare;
+            lastScore = bookScore;
+        }
+    }
+    
+    //iterative deepening; each completed iteration replaces bestSquare
+    int maxDepth = testingMinimax ? 2 : SEARCH_DEPTH; //testminimax checks a plain 2-ply search
+    int depthReached = 0;
+    for (int depth = 1; engine == ENGINE_ALPHABETA && canMove && !inBook && depth <= maxDepth; depth++) {
+        if (timeLimit >= 0 && !timing.nextIterationFits(elapsedMs(start), timeLimit))
+            break; //the next iteration would most likely be cut off anyway
+        std::chrono::steady_clock::time_point iterationStart = std::chrono::steady_clock::now();
+        unsigned long long iterationNodes = nodes;
+        Move* iterationMove = getBestMove(board, depth, INT_MIN, INT_MAX, true); //using minimax to find best move
+        timing.endIteration(nodes - iterationNodes, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - iterationStart).count(), !stopRequested);
+        std::lock_guard<std::mutex> lock(searchLock);
+        if (!stopRequested) {
+            bestSquare = iterationMove->getX() + 8 * iterationMove->getY();
+            depthReached = depth;
+        }
+        delete iterationMove;
+        if (stopRequested)
+            break;
+    }
+    
+    //MCTS searches in place of iterative deepening, leaving most of the time to the solver if it runs next
+    if (engine == ENGINE_MCTS && canMove && !inBook) {
+        bool solverNext = useSolver && empties <= ENDGAME_EMPTIES;
+        int budget = (timeLimit < 0) ? -1 : (solverNext ? timeLimit / 4 : timeLimit * 3 / 4);
+        uint64_t own, opp;
+        getSideBits(board, own, opp);
+        int square = mcts->search(own, opp, budget, (timeLimit < 0) ? MCTS_UNTIMED_PLAYOUTS : 0);
+        nodes += mcts->playouts;
+        std::lock_guard<std::mutex> lock(searchLock);
+        if (!stopRequested && square >= 0) {
+            bestSquare = square;
+            lastScore = (int) (mcts->winRate * 100); //percent
+        }
+    }
+    
+    //close to the end, the heuristic move is only a fallback for an exact solve
+    if (canMove && useSolver && !testingMinimax && empties <= ENDGAME_EMPTIES
+            && (timeLimit < 0 || elapsedMs(start) <= timeLimit / 2)) {
+        uint64_t own, opp;
+        getSideBits(board, own, opp);
+        int move;
+        int score = solver.solve(own, opp, move);
+        nodes += solver.nodes;
+        std::lock_guard<std::mutex> lock(searchLock);
+        if (!stopRequested) {
+            bestSquare = move;
+            depthReached = empties;
+            lastScore = score;
+        }
+    }
+    
+    int square;
+    {
+        std::lock_guard<std::mutex> lock(searchLock);
+        square = bestSquare; //same move stopSearch() handed out, if it was called
+    }
+    Move* selectedMove = (square < 0) ? NULL : new Move(square % 8, square / 8);
     board->doMove(selectedMove, playerSide); //perform my own move
     
+    MoveTiming moveTiming = {empties, msLeft, timeLimit, elapsedMs(start), depthReached, nodes - startNodes};
+    timing.endMove(moveTiming);
+    if (recorder != NULL) {
+        MoveInfo info;
+        info.msLeft = msLeft;
+        info.timeMs = moveTiming.timeMs;
+        info.nodes = nodes - startNodes;
+        info.depth = depthReached;
+        info.score = lastScore;
+        recorder->addMove(selectedMove);
+        recorder->addInfo(info);
+    }
     return selectedMove;
 }
 
+/*
+ * Hard limit in milliseconds for the move about to be computed, or -1 if there is none. Spends at most twice an 
+ * even share of the remaining time over our remaining moves, and never the last SAFETY_MS.
+ */
+int Player::getTimeLimit(int msLeft) {
+    if (msLeft < 0 || testingMinimax)
+        return -1;
+    int movesLeft = std::max(1, (board->countEmpty() + 1) / 2);
+    int limit = std::min(msLeft - SAFETY_MS, 2 * msLeft / movesLeft);
+    return std::max(limit, 1);
+}
+
+/*
+ * doMove under its time limit, the way a game is played: the search runs on a worker thread while the calling 
+ * thread keeps the deadline of getTimeLimit(msLeft), and if that passes the search is stopped and the best move 
+ * so far taken. Returns the square played (x + 8*y, -1 for a pass). reply, if given, is called with it as soon as 
+ * it is known, before a stopped search has finished unwinding.
+ */
+int Player::doMoveTimed(Move *opponentsMove, int msLeft, const std::function<void(int)> &reply) {
+    int timeLimit = getTimeLimit(msLeft);
+    int moveTurn;
+    {
+        std::lock_guard<std::mutex> guard(searchLock);
+        moveTurn = turn + 1; //the turn the doMove below publishes
+    }
+    
+    std::mutex lock;
+    std::condition_variable finished;
+    bool done = false;
+    int played = -1;
+    std::thread search([&] {
+        Move *move = doMove(opponentsMove, msLeft);
+        std::lock_guard<std::mutex> guard(lock);
+        played = (move == NULL) ? -1 : move->getX() + 8 * move->getY();
+        delete move;
+        done = true;
+        finished.notify_one();
+    });
+    
+    int square;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        bool inTime = true;
+        if (timeLimit < 0)
+            finished.wait(guard, [&] { return done; });
+        else
+            inTime = finished.wait_for(guard, std::chrono::milliseconds(timeLimit), [&] { return done; });
+        if (inTime) {
+            square = played;
+        } else {
+            guard.unlock();
+            square = stopSearch(moveTurn);
+        }
+    }
+    if (reply)
+        reply(square);
+    search.join();
+    return square;
+}
+
+/*
+ * Stops the search for the given turn (the turn-th call to doMove) and returns the move it will play: the move 
+ * from the last completed iteration, or any legal move if none has completed yet (-1 for a pass). Waits for that 
+ * doMove to have started if it has not yet. Safe to call from another thread; doMove returns as soon as the 
+ * search notices.
+ */
+int Player::stopSearch(int turn) {
+    std::unique_lock<std::mutex> lock(searchLock);
+    searchReady.wait(lock, [this, turn] { return this->turn >= turn; });
+    stopRequested = true;
+    return bestSquare;
+}
+
+int Player::elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
 Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool isPlayerSide) {
 	if (depth == 0)
 		return NULL; //nothing to do here lol
+	TableKey key = positionKey(board, isPlayerSide);
+	TableEntry entry;
+	int hashMove = probeTable(key, entry) ? entry.move : -1; //only used for move ordering at the root
+	int alphaOrig = alpha;
+	int betaOrig = beta;
 	if (isPlayerSide) {
 		//get all legal moves
 		std::vector<Move*> legalMoves = getLegalMoves(board, playerSide);
 		if (legalMoves.size() == 0)
 			return NULL; //no legal moves, return null
+		moveToFront(legalMoves, hashMove);
 		
 		Board * testBoard = board->copy(); //board to test our legal moves on
 		int bestScore = INT_MIN; //best score obtained from our legal moves
@@ -68,8 +337,9 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 		for (unsigned int i = 0; i < legalMoves.size(); i++) {
 			Move* candidateMove = legalMoves[i];
 			testBoard->doMoveUnchecked(candidateMove, playerSide);
+			TableKey childKey = prefetchKey(testBoard, false, depth - 1);
 			//update bestScore, bestMove
-			int score = getBestScore(testBoard, depth - 1, alpha, beta, false);
+			int score = searchScore(testBoard, depth - 1, alpha, beta, false, childKey);
 			if (score > bestScore) {
 				bestScore = score;
 				bestMove = candidateMove;
@@ -77,10 +347,14 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 
 			alpha = std::max(alpha, bestScore); //update alpha
 			
-			testBoard->undoMove(candidateMove); //revert the testboard back to the original position
+			*testBoard = *board; //revert the testboard back to the original position
 			if (beta <= alpha) //alpha-beta pruning
 				break;
 		}	
+		if (!stopRequested) {
+			storeTable(key, depth, alphaOrig, betaOrig, bestScore, bestMove);
+			lastScore = bestScore;
+		}
 		delete testBoard; //freeing the testboard, as we no longer need it
 		for (unsigned int i = 0; i < legalMoves.size(); i++)
 			if (legalMoves[i] != bestMove)
@@ -92,6 +366,7 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 		std::vector<Move*> legalMoves = getLegalMoves(board, otherSide);
 		if (legalMoves.size() == 0)
 			return NULL; //no legal moves, return null
+		moveToFront(legalMoves, hashMove);
 		
 		Board * testBoard = board->copy(); //board to test our legal moves on
 		int worstScore = INT_MAX; //worst score (for playerSide) obtained from our legal moves
@@ -99,8 +374,9 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 		for (unsigned int i = 0; i < legalMoves.size(); i++) {
 			Move* candidateMove = legalMoves[i];
 			testBoard->doMoveUnchecked(candidateMove, otherSide);
+			TableKey childKey = prefetchKey(testBoard, true, depth - 1);
 			//update worstScore, worstMove
-			int score = getBestScore(testBoard, depth - 1, alpha, beta, true);
+			int score = searchScore(testBoard, depth - 1, alpha, beta, true, childKey);
 			if (score < worstScore) {
 				worstScore = score;
 				worstMove = candidateMove;
@@ -108,10 +384,14 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 			
 			beta = std::min(beta, worstScore); //update beta
 			
-			testBoard->undoMove(candidateMove); //revert the testboard back to the original position
+			*testBoard = *board; //revert the testboard back to the original position
 			if (beta <= alpha) //alpha-beta pruning
 				break;
 		}
+		if (!stopRequested) {
+			storeTable(key, depth, alphaOrig, betaOrig, worstScore, worstMove);
+			lastScore = worstScore;
+		}
 		delete testBoard; //freeing the testboard, as we no longer need it
 		for (unsigned int i = 0; i < legalMoves.size(); i++)
 			if (legalMoves[i] != worstMove)
@@ -121,26 +401,154 @@ Move* Player::getBestMove(Board * board, int depth, int alpha, int beta, bool is
 	}
 }
 
+/*
+ * Multi-PV: the k best moves for playerSide (fewer if there are not that many), best first, each with its exact
+ * score and principal variation, from one iterative deepening search to the given depth. Every root move gets its
+ * own window: alpha is the k-th best score found so far in the iteration, so a move either proves it belongs in
+ * the top k (and its score is exact) or fails low as cheaply as it would in a plain search. The moves are tried in
+ * the order of the previous iteration's scores, and all of them share the transposition table.
+ */
+std::vector<RootLine> Player::getBestMoves(Board * board, int depth, int k) {
+	std::vector<RootLine> lines;
+	std::vector<Move*> legalMoves = getLegalMoves(board, playerSide);
+	if (legalMoves.empty() || k <= 0)
+		return lines;
+	table.newSearch();
+	TableKey key = positionKey(board, true);
+	TableEntry entry;
+	if (probeTable(key, entry))
+		moveToFront(legalMoves, entry.move);
+	std::vector<int> order; //indices into legalMoves, most promising first
+	std::vector<int> scores(legalMoves.size(), INT_MIN); //last score of each move; a bound if it failed low
+	for (unsigned int i = 0; i < legalMoves.size(); i++)
+		order.push_back(i);
+	
+	Board * testBoard = board->copy();
+	int completed = 0; //depth of the iteration lines comes from
+	for (int d = 1; d <= depth; d++) {
+		std::vector<RootLine> iteration;
+		for (unsigned int i = 0; i < order.size(); i++) {
+			Move* candidateMove = legalMoves[order[i]];
+			int alpha = ((int) iteration.size() < k) ? INT_MIN : iteration.back().score;
+			testBoard->doMoveUnchecked(candidateMove, playerSide);
+			TableKey childKey = prefetchKey(testBoard, false, d - 1);
+			int score = searchScore(testBoard, d - 1, alpha, INT_MAX, false, childKey);
+			*testBoard = *board;
+			scores[order[i]] = score;
+			if (score <= alpha)
+				continue; //not in the top k
+			RootLine line;
+			line.square = candidateMove->getX() + 8 * candidateMove->getY();
+			line.score = score;
+			unsigned int j = iteration.size();
+			while (j > 0 && iteration[j - 1].score < score)
+				j--;
+			iteration.insert(iteration.begin() + j, line);
+			if ((int) iteration.size() > k)
+				iteration.pop_back();
+		}
+		if (stopRequested.load(std::memory_order_relaxed))
+			break; //keep the last complete iteration
+		lines = iteration;
+		completed = d;
+		std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return scores[a] > scores[b]; });
+	}
+	
+	if (!lines.empty() && !stopRequested) {
+		Move bestMove(lines[0].square % 8, lines[0].square / 8);
+		storeTable(key, depth, INT_MIN, INT_MAX, lines[0].score, &bestMove);
+		lastScore = lines[0].score;
+	}
+	for (unsigned int i = 0; i < lines.size(); i++) {
+		//the rest of each variation is read back from the table, as far as it holds exact results of the depth the
+		//last iteration searched each node to; a transposition may have replaced an entry with a bound or a
+		//shallower search, whose move need not be the best one
+		lines[i].pv.push_back(lines[i].square);
+		Move move(lines[i].square % 8, lines[i].square / 8);
+		testBoard->doMoveUnchecked(&move, playerSide);
+		bool isPlayerSide = false;
+		for (int ply = 1; ply < completed; ply++) {
+			if (!probeTable(positionKey(testBoard, isPlayerSide), entry) || entry.move < 0
+					|| entry.bound != BOUND_EXACT || entry.depth < completed - ply)
+				break;
+			Move next(entry.move % 8, entry.move / 8);
+			Side side = isPlayerSide ? playerSide : otherSide;
+			if (!testBoard->checkMove(&next, side))
+				break;
+			testBoard->doMoveUnchecked(&next, side);
+			lines[i].pv.push_back(entry.move);
+			isPlayerSide = !isPlayerSide;
+		}
+		*testBoard = *board;
+	}
+	delete testBoard;
+	for (unsigned int i = 0; i < legalMoves.size(); i++)
+		delete legalMoves[i];
+	return lines;
+}
+
 int Player::getBestScore(Board * board, int depth, int alpha, int beta, bool isPlayerSide) {
+	return searchScore(board, depth, alpha, beta, isPlayerSide, prefetchKey(board, isPlayerSide, depth));
+}
+
+/*
+ * getBestScore for a position whose table key the caller has already worked out (and prefetched).
+ */
+int Player::searchScore(Board * board, int depth, int alpha, int beta, bool isPlayerSide, const TableKey &key) {
+	nodes++;
+	if (stopRequested.load(std::memory_order_relaxed))
+		return 0; //the caller throws away everything from here on
 	if (depth == 0)
 		return getScore(board);
+	
+	TableEntry entry;
+	int hashMove = -1;
+	if (probeTable(key, entry)) {
+		if (entry.depth >= depth) { //deep enough to stand in for this search
+			if (entry.bound == BOUND_EXACT)
+				return entry.score;
+			if (entry.bound == BOUND_LOWER && entry.score >= beta)
+				return entry.score;
+			if (entry.bound == BOUND_UPPER && entry.score <= alpha)
+				return entry.score;
+		}
+		hashMove = entry.move;
+	}
+	int alphaOrig = alpha;
+	int betaOrig = beta;
+	int cutoffScore;
+	
 	if (isPlayerSide) {
 		std::vector<Move*> legalMoves = getLegalMoves(board, playerSide);
 		if (legalMoves.size() == 0)
 			return getScore(board);
+		moveToFront(legalMoves, hashMove);
+		if (enhancedCutoff(board, key, legalMoves, depth, alpha, beta, true, cutoffScore)) {
+			for (unsigned int i = 0; i < legalMoves.size(); i++)
+				delete legalMoves[i];
+			return cutoffScore;
+		}
 			
 		Board* testBoard = board->copy();
 		int bestScore = INT_MIN;
+		Move* bestMove = NULL;
 		for (unsigned int i = 0; i < legalMoves.size(); i++) {
 			Move* candidateMove = legalMoves[i];
 			testBoard->doMoveUnchecked(candidateMove, playerSide);
-			bestScore = std::max(bestScore, getBestScore(testBoard, depth - 1, alpha, beta, false)); //update bestScore
+			TableKey childKey = prefetchKey(testBoard, false, depth - 1);
+			int score = searchScore(testBoard, depth - 1, alpha, beta, false, childKey);
+			if (score > bestScore) { //update bestScore
+				bestScore = score;
+				bestMove = candidateMove;
+			}
 			alpha = std::max(alpha, bestScore); //update alpha
 			
-			testBoard->undoMove(candidateMove); //revert position
+			*testBoard = *board; //revert position
 			if (beta <= alpha) //alpha-beta pruning
 				break;
 		}
+		if (!stopRequested.load(std::memory_order_relaxed))
+			storeTable(key, depth, alphaOrig, betaOrig, bestScore, bestMove);
 		delete testBoard;
 		for (unsigned int i = 0; i < legalMoves.size(); i++)
 			delete legalMoves[i];
@@ -151,19 +559,33 @@ int Player::getBestScore(Board * board, int depth, int alpha, int beta, bool isP
 		std::vector<Move*> legalMoves = getLegalMoves(board, otherSide);
 		if (legalMoves.size() == 0)
 			return getScore(board);
+		moveToFront(legalMoves, hashMove);
+		if (enhancedCutoff(board, key, legalMoves, depth, alpha, beta, false, cutoffScore)) {
+			for (unsigned int i = 0; i < legalMoves.size(); i++)
+				delete legalMoves[i];
+			return cutoffScore;
+		}
 		
 		Board* testBoard = board->copy();
 		int worstScore = INT_MAX;
+		Move* worstMove = NULL;
 		for (unsigned int i = 0; i < legalMoves.size(); i++) {
 			Move* candidateMove = legalMoves[i];
 			testBoard->doMoveUnchecked(candidateMove, otherSide); 
-			worstScore = std::min(worstScore, getBestScore(testBoard, depth - 1, alpha, beta, true)); //update worstScore
+			TableKey childKey = prefetchKey(testBoard, true, depth - 1);
+			int score = searchScore(testBoard, depth - 1, alpha, beta, true, childKey);
+			if (score < worstScore) { //update worstScore
+				worstScore = score;
+				worstMove = candidateMove;
+			}
 			beta = std::min(beta, worstScore); //update beta
 			
-			testBoard->undoMove(candidateMove);
+			*testBoard = *board;
 			if (beta <= alpha) //alpha-beta pruning
 				break;
 		}
+		if (!stopRequested.load(std::memory_order_relaxed))
+			storeTable(key, depth, alphaOrig, betaOrig, worstScore, worstMove);
 		delete testBoard;
 		for (unsigned int i = 0; i < legalMoves.size(); i++)
 			delete legalMoves[i];
@@ -173,18 +595,134 @@ int Player::getBestScore(Board * board, int depth, int alpha, int beta, bool isP
 }
 
 
+/*
+ * 
+ * TRANSPOSITION TABLE
+ * 
+ */
+
+
+/*
+ * Table key for a position with the given side to move. Once the board is in the stone parity phase of getScore, 
+ * every symmetric form of a position has the same value, so (if useSymmetry is set) all 8 forms share one hash and 
+ * key.symmetry says how to map squares into that shared orientation. The positional table is not symmetric, so 
+ * earlier positions are always keyed as they stand.
+ */
+TableKey Player::positionKey(Board * board, bool isPlayerSide) {
+	TableKey key;
+	bool blackToMove = (isPlayerSide ? playerSide : otherSide) == BLACK;
+	uint64_t black = board->getBlackBits();
+	uint64_t white = board->getWhiteBits();
+	if (useSymmetry && 64 - popCount(black | white) <= SYMMETRY_EMPTIES) {
+		key.hash = canonicalHash(black, white, blackToMove, key.symmetry);
+	} else {
+		key.hash = hashPosition(black, white, blackToMove);
+		key.symmetry = 0;
+	}
+	return key;
+}
+
+/*
+ * Key for a position about to be searched to the given depth, with its bucket already on its way into the cache. 
+ * Called right after making a move, so the memory access overlaps with the work done before the probe. Leaves 
+ * are never probed and get no key.
+ */
+TableKey Player::prefetchKey(Board * board, bool isPlayerSide, int depth) {
+	if (!useTable || depth == 0) {
+		TableKey none = {0, 0};
+		return none;
+	}
+	TableKey key = positionKey(board, isPlayerSide);
+	table.prefetch(key.hash);
+	return key;
+}
+
+/*
+ * Looks the position up in the table. On a hit, entry.move is translated back into this board's orientation.
+ */
+bool Player::probeTable(const TableKey &key, TableEntry &entry) {
+	if (!useTable || !table.probe(key.hash, entry))
+		return false;
+	if (entry.move >= 0)
+		entry.move = transformSquare(inverseTransform(key.symmetry), entry.move);
+	return true;
+}
+
+/*
+ * Records a search result. alpha and beta are the window the search was started with; a score outside of it is 
+ * only a bound on the true value.
+ */
+void Player::storeTable(const TableKey &key, int depth, int alpha, int beta, int score, Move * move) {
+	if (!useTable)
+		return;
+	Bound bound = BOUND_EXACT;
+	if (score <= alpha)
+		bound = BOUND_UPPER;
+	else if (score >= beta)
+		bound = BOUND_LOWER;
+	int square = (move == NULL) ? -1 : transformSquare(key.symmetry, move->getX() + 8 * move->getY());
+	table.store(key.hash, score, depth, bound, square);
+}
+
+/*
+ * Enhanced Transposition Cutoff: before searching any child, check whether the table already holds a result for 
+ * one of them that is deep enough and good enough (for the side to move) to cut this node off. Probing is much 
+ * cheaper than searching, and a transposition found this way can save searching the whole first subtree. All 
+ * children are prefetched before the first probe so that their cache misses overlap.
+ */
+bool Player::enhancedCutoff(Board * board, const TableKey &key, std::vector<Move*> &legalMoves, int depth, 
+		int alpha, int beta, bool isPlayerSide, int &score) {
+	if (!useTable || !useETC || depth < ETC_MIN_DEPTH)
+		return false;
+	Side side = isPlayerSide ? playerSide : otherSide;
+	Board testBoard = *board;
+	TableKey childKeys[64];
+	for (unsigned int i = 0; i < legalMoves.size(); i++) {
+		testBoard.doMoveUnchecked(legalMoves[i], side);
+		childKeys[i] = prefetchKey(&testBoard, !isPlayerSide, depth - 1);
+		testBoard = *board;
+	}
+	for (unsigned int i = 0; i < legalMoves.size(); i++) {
+		TableEntry entry;
+		if (!probeTable(childKeys[i], entry) || entry.depth < depth - 1)
+			continue;
+		//the child's value is at least entry.score unless it is an upper bound, and at most it unless a lower bound
+		bool cutoff = isPlayerSide ? (entry.bound != BOUND_UPPER && entry.score >= beta)
+			: (entry.bound != BOUND_LOWER && entry.score <= alpha);
+		if (cutoff) {
+			score = entry.score;
+			storeTable(key, depth, alpha, beta, score, legalMoves[i]);
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Moves the move on the given square (if any) to the front of the list, so that it is searched first.
+ */
+void Player::moveToFront(std::vector<Move*> &moves, int square) {
+	if (square < 0)
+		return;
+	for (unsigned int i = 0; i < moves.size(); i++) {
+		if (moves[i]->getX() + 8 * moves[i]->getY() == square) {
+			std::swap(moves[0], moves[i]);
+			return;
+		}
+	}
+}
+
 
 /*
  * Returns all legal moves for a given side.
  */
 std::vector<Move*> Player::getLegalMoves(Board * board, Side side) {
 	std::vector<Move*> legalMoves;
-	for (int r = 0; r < 8; r++) {
-		for (int c = 0; c < 8; c++) {
-			Move candidateMove(r,c);
-			if (board->checkMove(&candidateMove, side))
-				legalMoves.push_back(new Move(candidateMove.getX(), candidateMove.getY()));
-		}
+	uint64_t own, opp;
+	board->getSideBits(side, own, opp);
+	for (uint64_t moves = legalMoveMask(own, opp); moves; moves &= moves - 1) {
+		int square = firstSquare(moves);
+		legalMoves.push_back(new Move(square % 8, square / 8));
 	}
 	return legalMoves;
 }
@@ -202,22 +740,44 @@ void Player::setBoard(Board * otherBoard) {
 
 
 /*
- * General heuristic function to avoid replacing the rest of my code whenever I decide to change the heuristic.
+ * Leaf score from playerSide's point of view. Positions past the stone parity phase are looked up in the
+ * evaluation cache first.
  */
 int Player::getScore(Board* board) {
+	if (testingMinimax)
+		return getStoneParity(board);
+	if (!useEvalCache || board->countEmpty() <= EVAL_CACHE_EMPTIES)
+		return evaluate(board);
+	
+	//scores are from playerSide's point of view, so that goes into the key instead of the side to move
+	uint64_t key = hashPosition(board->getBlackBits(), board->getWhiteBits(), playerSide == BLACK);
+	int score;
+	if (!evalCache.probe(key, score)) {
+		score = evaluate(board);
+		evalCache.store(key, score);
+	}
+	return score;
+}
+
+/*
+ * General heuristic function to avoid replacing the rest of my code whenever I decide to change the heuristic.
+ */
+int Player::evaluate(Board* board) {
 	int emptySquares = board->countEmpty();
 	
 	if (emptySquares > 35) {
 		//Stone parity absolutely does not matter. Mobility and position are more important.	
-		//~ int mobilityPart = getMobilityScore(board) * 5; //one legal move is worth 1/10 of a corner
 		int positionalPart = getPositionalScore(board);
-		return positionalPart;
+		int mobilityPart = getCornerMobilityScore(board) * 5; //one legal move is worth 1/10 of a corner
+		int potentialPart = getPotentialMobilityScore(board) * 2; //future moves count for less than moves now
+		return mobilityPart + potentialPart + positionalPart;
 	}
 	else if (emptySquares > 20) {
 		int positionalPart = getPositionalScore(board);
 		int stabilityPart = getStabilityScore(board) * 40; //stables are very valuable
-		int mobilityPart = getMobilityScore(board) * 5; //mobility is slightly less important now
-		return mobilityPart + stabilityPart + positionalPart;
+		int mobilityPart = getCornerMobilityScore(board) * 5; //mobility is slightly less important now
+		int potentialPart = getPotentialMobilityScore(board) * 2;
+		return mobilityPart + potentialPart + stabilityPart + positionalPart;
 	}
 	else {
 		return getStoneParity(board);
@@ -245,59 +805,74 @@ int Player::getAdjustedStoneParity(Board* board) {
 
 /*
  * Mobility score is the difference in the number of legal moves between the player and the opponent.
+ * A square where both sides could move counts for the player only.
  */
 int Player::getMobilityScore(Board* board) {
-	int score = 0;
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			Move move(i,j);
-			if (board->checkMove(&move, playerSide))
-				score++;
-			else if (board->checkMove(&move, otherSide))
-				score--;
-		}
-	}
-	return score;
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
+	uint64_t playerMoves = legalMoveMask(own, opp);
+	uint64_t opponentMoves = legalMoveMask(opp, own) & ~playerMoves;
+	return popCount(playerMoves) - popCount(opponentMoves);
 }
 
 /*
  * Adjusted by total number of legal moves for both sides.
  */
 int Player::getAdjustedMobilityScore(Board* board) {
-	int playerMoves = 0;
-	int opponentMoves = 0;
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			Move move(i,j);
-			if (board->checkMove(&move,playerSide))
-				playerMoves++;
-			if (board->checkMove(&move,otherSide))
-				opponentMoves++;
-		}
-	}
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
+	int playerMoves = popCount(legalMoveMask(own, opp));
+	int opponentMoves = popCount(legalMoveMask(opp, own));
 	if (playerMoves + opponentMoves == 0)
 		return 0;
 	else
 		return (SCALE_CONSTANT * (playerMoves - opponentMoves)) / (playerMoves + opponentMoves);
 }
 
+/*
+ * Mobility where a move onto a corner counts CORNER_MOBILITY_WEIGHT times, since it is worth far more than any 
+ * other move. Each side's moves are counted in full.
+ */
+int Player::getCornerMobilityScore(Board* board) {
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
+	uint64_t playerMoves = legalMoveMask(own, opp);
+	uint64_t opponentMoves = legalMoveMask(opp, own);
+	return popCount(playerMoves) - popCount(opponentMoves)
+		+ (CORNER_MOBILITY_WEIGHT - 1) * (popCount(playerMoves & CORNERS) - popCount(opponentMoves & CORNERS));
+}
+
+/*
+ * Potential mobility: empty squares next to opponent stones are where the player may get moves later on, and 
+ * the reverse for the opponent. Having few frontier stones of your own is good.
+ */
+int Player::getPotentialMobilityScore(Board* board) {
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
+	uint64_t empty = ~(own | opp);
+	return popCount(neighbors(opp) & empty) - popCount(neighbors(own) & empty);
+}
+
+/*
+ * Splits the board into the player's and the opponent's stones.
+ */
+void Player::getSideBits(Board* board, uint64_t &own, uint64_t &opp) {
+	uint64_t black = board->getBlackBits();
+	uint64_t white = board->getWhiteBits();
+	own = (playerSide == BLACK) ? black : white;
+	opp = (playerSide == BLACK) ? white : black;
+}
+
 
 /*
  * Difference in the number of corners captured.
  */
 int Player::getCornerScore(Board* board) {
-	int score = 0;
-	for (int i = 0; i < 8; i += 7) {
-		for (int j = 0; j < 8; j += 7) {
-			if (board->get(playerSide, i, j))
-				score++;
-			else if (board->get(otherSide, i, j))
-				score--;
-		}
-	}
-	return score;
-	
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
+	return popCount(own & CORNERS) - popCount(opp & CORNERS);
 }
+
 /*
  * Adjusted to fit to the same range.
  */
@@ -305,48 +880,33 @@ int Player::getAdjustedCornerScore(Board* board) {
 	return (SCALE_CONSTANT * getCornerScore(board)) / 4;
 } 
 
-const int Player::squareValues[8][8] = {
-	{99, -8, 8, 6, 6, 8, -8, 99},
-	{-8, -24, -4, -3, -3, -4, -24, -4},
-	{8, -4, 7, 4, 4, 7, -4, 8},
-	{6, -3, 4, 0, 0, 4, -3, 6},
-	{6, -3, 4, 0, 0, 4, -3, 6},
-	{8, -4, 7, 4, 4, 7, -4, 8},
-	{-8, -24, -4, -3, -3, -4, -24, -4},
-	{99, -8, 8, 6, 6, 8, -8, 99}
-};  
-
 /*
  * Naive score function for the disk-square table.
  * Certain squares are more valuable than others, so we rank them accordingly.
  */
 int Player::getPositionalScore(Board* board) {
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
 	int score = 0;
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			if (board->get(playerSide,i,j)) 
-				score += squareValues[i][j];
-			else if (board->get(otherSide,i,j))
-				score -= squareValues[i][j];
-		 }
-	 }
-	 return score;
+	for (; own; own &= own - 1)
+		score += SQUARE_WEIGHTS[firstSquare(own)];
+	for (; opp; opp &= opp - 1)
+		score -= SQUARE_WEIGHTS[firstSquare(opp)];
+	return score;
 }
  
  /*
   * Positional score, adjusted by the total number of positional points on each side.
   */
 int Player::getAdjustedPositionalScore(Board* board) {
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
 	int playerScore = 0;
 	int opponentScore = 0;
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			if (board->get(playerSide,i,j)) 
-				playerScore += squareValues[i][j];
-			else if (board->get(otherSide,i,j))
-				opponentScore += squareValues[i][j];
-		}
-	}
+	for (; own; own &= own - 1)
+		playerScore += SQUARE_WEIGHTS[firstSquare(own)];
+	for (; opp; opp &= opp - 1)
+		opponentScore += SQUARE_WEIGHTS[firstSquare(opp)];
 	if (playerScore + opponentScore == 0)
 		return 0;
 	else
@@ -364,113 +924,53 @@ int Player::getAdjustedPositionalScore(Board* board) {
  * check for more stable pieces given condition 3.
  */
 int Player::getStabilityScore(Board* board) {
-	std::vector<bool> stablePlayer(64, false); //Position i,j will be indexed 8*i + j
-	std::vector<bool> stableOpponent(64, false);
+	uint64_t own, opp;
+	getSideBits(board, own, opp);
 	/*
-	 * Check for filled rows, columns, and diagonals.
+	 * Squares whose lines are filled, one mask per axis: every line through an empty square is not.
 	 */
-	std::vector<bool> filledRows(8,true);
-	std::vector<bool> filledCols(8,true);
-	//a positive diagonal's index is indicated by i+j, which can take values from 0 to 14
-	std::vector<bool> filledPosDiags(15,true);
-	//a negative diagonal's index is indicated by i-j+7
-	std::vector<bool> filledNegDiags(15,true); 
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			if (!(board->occupied(i,j))) {
-				filledRows[i] = false;
-				filledCols[j] = false;
-				filledPosDiags[i+j] = false;
-				filledNegDiags[i-j+7] = false;
-			}
-		}
+	uint64_t filled[4] = {~0ULL, ~0ULL, ~0ULL, ~0ULL};
+	for (uint64_t empty = ~(own | opp); empty; empty &= empty - 1) {
+		int square = firstSquare(empty);
+		for (int line = 0; line < 4; line++)
+			filled[line] &= ~GEOMETRY.lines[line][square];
 	}
 	
 	/*
-	 * Get all Type 1 and Type 2 stable disks
+	 * Squares where each axis is settled by conditions 1 and 2: boundaries and filled lines. Boundaries count 
+	 * for the diagonals whichever edge they are on.
 	 */
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			bool occupied = board->occupied(i,j);
-			bool horizontalBoundary = (i == 0) || (i == 7);
-			bool verticalBoundary = (j == 0) || (j == 7);
-			bool horizontal = horizontalBoundary || filledRows[i];
-			bool vertical = verticalBoundary || filledCols[j];
-			bool posDiag = horizontalBoundary || verticalBoundary || filledPosDiags[i+j];
-			bool negDiag = horizontalBoundary || verticalBoundary || filledNegDiags[i-j+7];
-			if(occupied && horizontal && vertical && posDiag && negDiag) {
-				if (board->get(playerSide, i, j))
-					stablePlayer[8*i + j] = true;
-				else
-					stableOpponent[8*i + j] = true;
-			}
-		}
-	}
+	uint64_t horizontal = EDGE_COLUMNS | filled[LINE_COLUMN];
+	uint64_t vertical = EDGE_ROWS | filled[LINE_ROW];
+	uint64_t posDiag = EDGES | filled[LINE_ANTI_DIAGONAL];
+	uint64_t negDiag = EDGES | filled[LINE_DIAGONAL];
+	uint64_t stablePlayer = own & horizontal & vertical & posDiag & negDiag;
+	uint64_t stableOpponent = opp & horizontal & vertical & posDiag & negDiag;
 	
 	/*
-	 * Seek disks with type 3 requirement
+	 * Condition 3, until no more stones become stable.
 	 */
-	int improvement = INT_MAX;
-	while(improvement > 0) {
-		improvement = 0;
-		for (int i = 0; i < 8; i++) {
-			for (int j = 0; j < 8; j++) {
-				if (board->get(playerSide, i, j) && !stablePlayer[8*i + j]) {
-					 
-					bool horizontalBoundary = (i == 0) || (i == 7);
-					bool verticalBoundary = (j == 0) || (j == 7);
-					bool boundary = horizontalBoundary || verticalBoundary;
-					
-					bool horizontalNeighbor = horizontalBoundary || stablePlayer[8*(i-1) + j] || stablePlayer[8*(i+1) + j];
-					bool verticalNeighbor = verticalBoundary || stablePlayer[8 * i + (j-1)] || stablePlayer[8 * i + (j+1)];
-					bool posDiagNeighbor = boundary || stablePlayer[8*(i+1) + (j-1)] || stablePlayer[8*(i-1) + (j+1)];
-					bool negDiagNeighbor = boundary || stablePlayer[8*(i-1) + (j-1)] || stablePlayer[8*(i+1) + (j+1)];
-					
-					bool horizontal = filledRows[i] || horizontalNeighbor;
-					bool vertical = filledCols[j] || verticalNeighbor;
-					bool posDiag = posDiagNeighbor || filledPosDiags[i+j];
-					bool negDiag = negDiagNeighbor || filledNegDiags[i-j+7];
-					if (horizontal && vertical && posDiag && negDiag) {
-						stablePlayer[8*i + j] = true;
-						improvement++;
-					}
-				}
-				else if (board->get(otherSide, i, j) && !stableOpponent[8*i + j]) {
-					bool horizontalBoundary = (i == 0) || (i == 7);
-					bool verticalBoundary = (j == 0) || (j == 7);
-					bool boundary = horizontalBoundary || verticalBoundary;
-					
-					bool horizontalNeighbor = horizontalBoundary || stableOpponent[8*(i-1) + j] || stableOpponent[8*(i+1) + j];
-					bool verticalNeighbor = verticalBoundary || stableOpponent[8 * i + (j-1)] || stableOpponent[8 * i + (j+1)];
-					bool posDiagNeighbor = boundary || stableOpponent[8*(i+1) + (j-1)] || stableOpponent[8*(i-1) + (j+1)];
-					bool negDiagNeighbor = boundary || stableOpponent[8*(i-1) + (j-1)] || stableOpponent[8*(i+1) + (j+1)];
-					
-					bool horizontal = filledRows[i] || horizontalNeighbor;
-					bool vertical = filledCols[j] || verticalNeighbor;
-					bool posDiag = posDiagNeighbor || filledPosDiags[i+j];
-					bool negDiag = negDiagNeighbor || filledNegDiags[i-j+7];
-					if (horizontal && vertical && posDiag && negDiag) {
-						stableOpponent[8*i + j] = true;
-						improvement++;
-					}
-				}
-			}
-		}
+	while (true) {
+		uint64_t player = own & stableAxes(stablePlayer, horizontal, vertical, posDiag, negDiag);
+		uint64_t opponent = opp & stableAxes(stableOpponent, horizontal, vertical, posDiag, negDiag);
+		if ((player | stablePlayer) == stablePlayer && (opponent | stableOpponent) == stableOpponent)
+			break;
+		stablePlayer |= player;
+		stableOpponent |= opponent;
 	}
-	
-	int playerStableCount = 0;
-	int opponentStableCount = 0;
-	for (unsigned int i = 0; i < stablePlayer.size(); i++) {
-		if (stablePlayer[i])
-			playerStableCount++;
-		if (stableOpponent[i])
-			opponentStableCount++;
-	}
-	
-	if (playerStableCount + opponentStableCount == 0)
-		return 0;
-	else 
-		return playerStableCount - opponentStableCount;
+	return popCount(stablePlayer) - popCount(stableOpponent);
+}
+
+/*
+ * Squares where each axis is settled, either as given or by a stable neighbour on it.
+ */
+uint64_t Player::stableAxes(uint64_t stable, uint64_t horizontal, uint64_t vertical, uint64_t posDiag, 
+		uint64_t negDiag) {
+	horizontal |= shiftEast(stable) | shiftWest(stable);
+	vertical |= shiftNorth(stable) | shiftSouth(stable);
+	posDiag |= shiftSouthWest(stable) | shiftNorthEast(stable);
+	negDiag |= shiftSouthEast(stable) | shiftNorthWest(stable);
+	return horizontal & vertical & posDiag & negDiag;
 }
 
 
@@ -6,11 +6,49 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cmath>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <functional>
 #include "common.h"
 #include "board.h"
+#include "bitboard.h"
+#include "ttable.h"
+#include "gamerecord.h"
+#include "endgame.h"
+#include "book.h"
+#include "mcts.h"
+#include "telemetry.h"
 using namespace std;
 
 
+/*
+ * Search used by doMove, chosen when the player is made.
+ */
+enum Engine {
+    ENGINE_ALPHABETA, ENGINE_MCTS
+};
+
+/*
+ * Where a position lives in the transposition table: its hash, and the symmetry that maps the board into the 
+ * orientation its entry is stored in.
+ */
+struct TableKey {
+	uint64_t hash;
+	int symmetry;
+};
+
+/*
+ * One of the root moves returned by a multi-PV search: the move, its exact score and its principal variation 
+ * (squares x + 8*y, starting with the move itself).
+ */
+struct RootLine {
+	int square;
+	int score;
+	std::vector<int> pv;
+};
 
 
 class Player {
@@ -20,25 +58,71 @@ private:
 	Board * board;
 	Side playerSide;
 	Side otherSide;
+	TranspositionTable table;
+	EndgameSolver solver;
+	OpeningBook book;
+	Engine engine;
+	MctsSearch * mcts; //only for ENGINE_MCTS
+	GameRecorder * recorder;
+	bool firstMove;
+	int lastScore; //score of the last root search
+	
+	// Hand-off between doMove and stopSearch, which may run on another thread.
+	std::mutex searchLock;
+	std::condition_variable searchReady;
+	int turn; //number of doMove calls that have published a fallback move
+	int bestSquare; //move doMove will play, x + 8*y, -1 for a pass
+	std::atomic<bool> stopRequested;
 	
+	TableKey positionKey(Board * board, bool isPlayerSide);
+	TableKey prefetchKey(Board * board, bool isPlayerSide, int depth);
+	bool probeTable(const TableKey &key, TableEntry &entry);
+	void storeTable(const TableKey &key, int depth, int alpha, int beta, int score, Move * move);
+	bool enhancedCutoff(Board * board, const TableKey &key, std::vector<Move*> &legalMoves, int depth, 
+		int alpha, int beta, bool isPlayerSide, int &score);
+	int searchScore(Board * board, int depth, int alpha, int beta, bool isPlayerSide, const TableKey &key);
+	void moveToFront(std::vector<Move*> &moves, int square);
+	int elapsedMs(std::chrono::steady_clock::time_point start);
+	int evaluate(Board * board);
+	uint64_t stableAxes(uint64_t stable, uint64_t horizontal, uint64_t vertical, uint64_t posDiag, uint64_t negDiag);
 
 public:
 
-    Player(Side side);
+    Player(Side side, size_t tableKB = TABLE_DEFAULT_KB, int solverThreads = 0, Engine engine = ENGINE_ALPHABETA);
     ~Player();
     
     void setBoard(Board * otherBoard);
+    void recordTo(const char * path);
+    void checkpointRecord();
+    void setTableSize(size_t sizeKB);
+    void setTables(const SharedTables * tables);
     
     Move * doMove(Move *opponentsMove, int msLeft);
+    int doMoveTimed(Move *opponentsMove, int msLeft, const std::function<void(int)> &reply = nullptr);
+    int getTimeLimit(int msLeft);
+    int stopSearch(int turn);
 
     // Flag to tell if the player is running within the test_minimax context
     bool testingMinimax;
     
+    // Search options, all on by default except useSymmetry and useEvalCache. nodes counts calls to getBestScore
+    // and solver nodes.
+    bool useTable;
+    bool useETC;
+    bool useSymmetry;
+    bool useSolver;
+    bool useEvalCache;
+    bool useBook;
+    unsigned long long nodes;
+    EvalCache evalCache; //public for its hit counters
+    TimeModel timing; //public for its per-move log and summary
+    
     std::vector<Move*> getLegalMoves(Board * board, Side side);
     
     // two versions of alpha-beta; one version to return Move* and one to return int (scores) 
     Move * getBestMove(Board * board, int depth, int alpha, int beta, bool isPlayerSide);
     int getBestScore(Board * board, int depth, int alpha, int beta, bool isPlayerSide);
+    std::vector<RootLine> getBestMoves(Board * board, int depth, int k);
     
     
     /*
@@ -51,11 +135,13 @@ public:
     
     int getMobilityScore(Board* board);
     int getAdjustedMobilityScore(Board* board);
+    int getCornerMobilityScore(Board* board);
+    int getPotentialMobilityScore(Board* board);
+    void getSideBits(Board* board, uint64_t &own, uint64_t &opp);
     
     int getCornerScore(Board* board);
     int getAdjustedCornerScore(Board* board);
     
-    static const int squareValues[8][8];
     int getPositionalScore(Board* board);
     int getAdjustedPositionalScore(Board* board);
     
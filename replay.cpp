@@ -0,0 +1,167 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include "common.h"
+#include "board.h"
+#include "player.h"
+#include "gamerecord.h"
+
+// Replays game records, rebuilding every position with the board's make-move, and prints a summary. With -d, also
+// prints every position as one line for analysis and tuning tools:
+//
+//   <64 chars, 'b', 'w' or '.', index x + 8*y> <side to move 'b' or 'w'> <move played, square or -1 for a pass>
+//
+// With -m K, annotates instead: every position where the side to move has a move gets the engine's K best moves
+// from one multi-PV search, each with its score (for the side to move) and principal variation:
+//
+//   <move number> <side to move> <move played> | <square> <score> <pv square ...> | ...
+//
+// usage: replay [-d | -m K] [file ...]   (reads stdin if no files are given)
+
+#define ANALYSIS_DEPTH 6
+
+struct Summary {
+    unsigned long long records;
+    unsigned long long mctsRecords;
+    unsigned long long moves;
+    unsigned long long badRecords;
+    unsigned long long wins, losses, draws;
+    unsigned long long engineMoves;
+    unsigned long long totalTimeMs;
+    unsigned long long totalDepth;
+    unsigned int maxTimeMs;
+};
+
+static void dumpPosition(Board *board, Side side, int square) {
+    char line[64 + 16];
+    uint64_t black = board->getBlackBits();
+    uint64_t white = board->getWhiteBits();
+    for (int i = 0; i < 64; i++) {
+        line[i] = ((black >> i) & 1) ? 'b' : ((white >> i) & 1) ? 'w' : '.';
+    }
+    sprintf(line + 64, " %c %d\n", (side == BLACK) ? 'b' : 'w', (square == RECORD_PASS) ? -1 : square);
+    fputs(line, stdout);
+}
+
+static void annotatePosition(Board *board, Side side, int square, int number, Player *players[2], int k) {
+    Player *player = players[(side == BLACK) ? 0 : 1];
+    std::vector<RootLine> lines = player->getBestMoves(board, ANALYSIS_DEPTH, k);
+    if (lines.empty())
+        return;
+    printf("%d %c %d", number, (side == BLACK) ? 'b' : 'w', (square == RECORD_PASS) ? -1 : square);
+    for (unsigned int i = 0; i < lines.size(); i++) {
+        printf(" | %d %d", lines[i].square, lines[i].score);
+        for (unsigned int j = 1; j < lines[i].pv.size(); j++)
+            printf(" %d", lines[i].pv[j]);
+    }
+    printf("\n");
+}
+
+// Plays the moves of one record. Returns false if a move is illegal. players is only used to annotate.
+static bool replayRecord(const GameRecord &record, bool dump, Player *players[2], int k) {
+    Board board;
+    Side side = BLACK;
+    for (unsigned int i = 0; i < record.moves.size(); i++) {
+        int square = record.moves[i];
+        if (dump)
+            dumpPosition(&board, side, square);
+        if (k > 0)
+            annotatePosition(&board, side, square, i + 1, players, k);
+        if (square == RECORD_PASS) {
+            if (board.hasMoves(side))
+                return false;
+        } else {
+            if (square > 63)
+                return false;
+            Move move(square % 8, square / 8);
+            if (!board.checkMove(&move, side))
+                return false;
+            board.doMoveUnchecked(&move, side);
+        }
+        side = (side == BLACK) ? WHITE : BLACK;
+    }
+    return true;
+}
+
+static bool replayStream(FILE *file, bool dump, Player *players[2], int k, Summary &summary) {
+    GameRecordReader reader(file);
+    GameRecord record;
+    while (reader.next(record)) {
+        summary.records++;
+        if (record.mcts)
+            summary.mctsRecords++;
+        summary.moves += record.moves.size();
+        if (!replayRecord(record, dump, players, k))
+            summary.badRecords++;
+        if (record.finalScore > 0)
+            summary.wins++;
+        else if (record.finalScore < 0)
+            summary.losses++;
+        else
+            summary.draws++;
+        for (unsigned int i = 0; i < record.info.size(); i++) {
+            summary.engineMoves++;
+            summary.totalTimeMs += record.info[i].timeMs;
+            summary.totalDepth += record.info[i].depth;
+            if (record.info[i].timeMs > summary.maxTimeMs)
+                summary.maxTimeMs = record.info[i].timeMs;
+        }
+    }
+    return !reader.failed;
+}
+
+int main(int argc, char *argv[]) {
+    bool dump = false;
+    int k = 0;
+    int first = 1;
+    if (argc > 1 && !strcmp(argv[1], "-d")) {
+        dump = true;
+        first = 2;
+    } else if (argc > 2 && !strcmp(argv[1], "-m")) {
+        k = atoi(argv[2]);
+        first = 3;
+    }
+    Player *players[2] = {NULL, NULL};
+    if (k > 0) {
+        players[0] = new Player(BLACK, TABLE_DEFAULT_KB, 1);
+        players[1] = new Player(WHITE, TABLE_DEFAULT_KB, 1);
+    }
+
+    Summary summary;
+    memset(&summary, 0, sizeof(summary));
+    clock_t start = clock();
+    bool ok = true;
+    if (first == argc) {
+        ok = replayStream(stdin, dump, players, k, summary);
+    }
+    for (int i = first; i < argc; i++) {
+        FILE *file = fopen(argv[i], "rb");
+        if (file == NULL) {
+            fprintf(stderr, "could not open %s\n", argv[i]);
+            return 1;
+        }
+        if (!replayStream(file, dump, players, k, summary)) {
+            fprintf(stderr, "%s: damaged record after %llu records\n", argv[i], summary.records);
+            ok = false;
+        }
+        fclose(file);
+    }
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+
+    delete players[0];
+    delete players[1];
+
+    FILE *out = (dump || k > 0) ? stderr : stdout;
+    fprintf(out, "%llu records (%llu MCTS), %llu moves, %llu with illegal moves\n", summary.records,
+        summary.mctsRecords, summary.moves, summary.badRecords);
+    fprintf(out, "engine: %llu wins, %llu losses, %llu draws\n", summary.wins, summary.losses, summary.draws);
+    if (summary.engineMoves > 0) {
+        fprintf(out, "engine moves: %llu, mean depth %.2f, mean time %.1f ms, max time %u ms\n",
+            summary.engineMoves, (double) summary.totalDepth / summary.engineMoves,
+            (double) summary.totalTimeMs / summary.engineMoves, summary.maxTimeMs);
+    }
+    if (seconds > 0)
+        fprintf(out, "%.2f s, %.0f moves/s\n", seconds, summary.moves / seconds);
+    return (ok && summary.badRecords == 0) ? 0 : 1;
+}
@@ -0,0 +1,342 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "server.h"
+
+#define READ_CHUNK 4096
+
+/*
+ * workers is the number of games searched at once; sessionTableKB sizes each session's transposition table.
+ * sharedTables, if not NULL, is handed to every session's player.
+ */
+EngineServer::EngineServer(const char *socketPath, int workers, size_t sessionTableKB,
+		const SharedTables *sharedTables) {
+	path = socketPath;
+	listenFd = -1;
+	wakeFds[0] = wakeFds[1] = -1;
+	numWorkers = std::max(workers, 1);
+	tableKB = sessionTableKB;
+	tables = sharedTables;
+	stopping = false;
+	inFlight = 0;
+	sessionsServed = 0;
+}
+
+EngineServer::~EngineServer() {
+	for (std::map<int, Session*>::iterator it = sessions.begin(); it != sessions.end(); ++it) {
+		close(it->first);
+		delete it->second->player;
+		delete it->second;
+	}
+	if (listenFd >= 0) {
+		close(listenFd);
+		unlink(path.c_str());
+	}
+	if (wakeFds[0] >= 0) {
+		close(wakeFds[0]);
+		close(wakeFds[1]);
+	}
+}
+
+/*
+ * Binds the socket, replacing any stale one left at the path. Returns false (after printing why) on failure.
+ */
+bool EngineServer::listen() {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (path.size() >= sizeof(address.sun_path)) {
+		fprintf(stderr, "socket path too long: %s\n", path.c_str());
+		return false;
+	}
+	strcpy(address.sun_path, path.c_str());
+
+	if (pipe(wakeFds) < 0) {
+		perror("pipe");
+		return false;
+	}
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listenFd < 0) {
+		perror("socket");
+		return false;
+	}
+	unlink(path.c_str());
+	if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) < 0 || ::listen(listenFd, 128) < 0) {
+		perror(path.c_str());
+		close(listenFd);
+		listenFd = -1;
+		return false;
+	}
+	return true;
+}
+
+/*
+ * Serves sessions until stop() is called. Call listen() first.
+ */
+void EngineServer::run() {
+	std::vector<std::thread> workers;
+	for (int i = 0; i < numWorkers; i++)
+		workers.push_back(std::thread(&EngineServer::workerLoop, this));
+	std::thread timer(&EngineServer::timerLoop, this);
+
+	std::vector<struct pollfd> fds;
+	while (!stopping) {
+		//sessions handed back by the workers are polled again, or queued at once if a line is already waiting
+		std::vector<Session*> done;
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			done.swap(released);
+		}
+		for (unsigned int i = 0; i < done.size(); i++) {
+			Session *session = done[i];
+			session->busy = false;
+			if (session->closing) {
+				sessions.erase(session->fd);
+				close(session->fd);
+				delete session->player;
+				delete session;
+			} else if (session->input.find('\n') != std::string::npos) {
+				enqueue(session);
+			}
+		}
+
+		fds.clear();
+		struct pollfd listenPoll = {listenFd, POLLIN, 0};
+		struct pollfd wakePoll = {wakeFds[0], POLLIN, 0};
+		fds.push_back(listenPoll);
+		fds.push_back(wakePoll);
+		for (std::map<int, Session*>::iterator it = sessions.begin(); it != sessions.end(); ++it) {
+			if (!it->second->busy) {
+				struct pollfd sessionPoll = {it->first, POLLIN, 0};
+				fds.push_back(sessionPoll);
+			}
+		}
+		if (poll(&fds[0], fds.size(), -1) < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("poll");
+			break;
+		}
+
+		if (fds[1].revents) {
+			char buffer[64];
+			if (read(wakeFds[0], buffer, sizeof(buffer)) < 0)
+				perror("read");
+		}
+		if (fds[0].revents & POLLIN) {
+			int fd = accept(listenFd, NULL, NULL);
+			if (fd >= 0) {
+				Session *session = new Session();
+				session->fd = fd;
+				session->player = NULL;
+				session->busy = false;
+				session->closing = false;
+				session->turn = 0;
+				sessions[fd] = session;
+			}
+		}
+		for (unsigned int i = 2; i < fds.size(); i++) {
+			if (fds[i].revents)
+				readSession(sessions[fds[i].fd]);
+		}
+	}
+
+	stopping = true;
+	queueReady.notify_all();
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	timerChanged.notify_all();
+	timer.join();
+}
+
+/*
+ * Makes run() return once the searches in progress are done. Safe to call from a signal handler.
+ */
+void EngineServer::stop() {
+	stopping = true;
+	wake();
+}
+
+void EngineServer::wake() {
+	char byte = 0;
+	if (write(wakeFds[1], &byte, 1) < 0)
+		perror("write");
+}
+
+/*
+ * Reads what the client sent; a complete line hands the session to the workers. End of file closes it.
+ */
+void EngineServer::readSession(Session *session) {
+	char buffer[READ_CHUNK];
+	ssize_t n = recv(session->fd, buffer, sizeof(buffer), 0);
+	if (n <= 0) {
+		if (n < 0 && errno == EINTR)
+			return;
+		sessions.erase(session->fd);
+		close(session->fd);
+		delete session->player;
+		delete session;
+		return;
+	}
+	session->input.append(buffer, n);
+	if (session->input.find('\n') != std::string::npos)
+		enqueue(session);
+}
+
+void EngineServer::enqueue(Session *session) {
+	session->busy = true;
+	session->arrival = std::chrono::steady_clock::now();
+	std::lock_guard<std::mutex> lock(queueLock);
+	queue.push_back(session);
+	inFlight++;
+	queueReady.notify_one();
+}
+
+/*
+ * Handles one line per queued session, then gives the session back to the polling thread.
+ */
+void EngineServer::workerLoop() {
+	while (true) {
+		Session *session;
+		{
+			std::unique_lock<std::mutex> lock(queueLock);
+			queueReady.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping)
+				return;
+			session = queue.front();
+			queue.pop_front();
+		}
+
+		size_t end = session->input.find('\n');
+		std::string line = session->input.substr(0, end);
+		session->input.erase(0, end + 1);
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (!handleLine(session, line))
+			session->closing = true;
+
+		{
+			std::lock_guard<std::mutex> lock(queueLock);
+			released.push_back(session);
+			inFlight--;
+		}
+		wake();
+	}
+}
+
+/*
+ * Stops every search whose deadline has passed. The lock is held while stopping, so that a worker that has taken
+ * its deadline off the list knows no late stop can reach its player's next move.
+ */
+void EngineServer::timerLoop() {
+	std::unique_lock<std::mutex> lock(timerLock);
+	while (!stopping) {
+		if (deadlines.empty()) {
+			timerChanged.wait(lock);
+			continue;
+		}
+		std::vector<Deadline>::iterator first = deadlines.begin();
+		for (std::vector<Deadline>::iterator it = deadlines.begin(); it != deadlines.end(); ++it) {
+			if (it->when < first->when)
+				first = it;
+		}
+		if (std::chrono::steady_clock::now() < first->when) {
+			timerChanged.wait_until(lock, first->when);
+			continue;
+		}
+		first->player->stopSearch(first->turn);
+		deadlines.erase(first);
+	}
+}
+
+/*
+ * Runs one protocol line for the session. Returns false if the session should be closed.
+ */
+bool EngineServer::handleLine(Session *session, const std::string &line) {
+	if (session->player == NULL) {
+		Side side;
+		if (line == "Black")
+			side = BLACK;
+		else if (line == "White")
+			side = WHITE;
+		else
+			return false;
+		//one solver thread per session: the worker pool already keeps every core busy
+		session->player = new Player(side, tableKB, 1);
+		if (tables != NULL)
+			session->player->setTables(tables);
+		sessionsServed++;
+		return sendLine(session, "Init done");
+	}
+
+	int moveX, moveY, msLeft;
+	std::istringstream in(line);
+	if (!(in >> moveX >> moveY >> msLeft))
+		return false;
+	Move *opponentsMove = NULL;
+	if (moveX >= 0 && moveY >= 0)
+		opponentsMove = new Move(moveX, moveY);
+	session->turn++;
+
+	//time spent waiting for a worker counts against the clock, and so will the waits for later moves: with more
+	//moves in flight than workers, each gets a proportional share of its clock
+	if (msLeft >= 0) {
+		int queuedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::steady_clock::now() - session->arrival).count();
+		msLeft = std::max(msLeft - queuedMs, 0);
+		int load = inFlight.load();
+		if (load > numWorkers)
+			msLeft = (int) ((long long) msLeft * numWorkers / load);
+	}
+	int timeLimit = session->player->getTimeLimit(msLeft);
+	if (timeLimit >= 0) {
+		Deadline deadline;
+		deadline.when = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeLimit);
+		deadline.player = session->player;
+		deadline.turn = session->turn;
+		std::lock_guard<std::mutex> lock(timerLock);
+		deadlines.push_back(deadline);
+		timerChanged.notify_one();
+	}
+
+	Move *playersMove = session->player->doMove(opponentsMove, msLeft);
+
+	if (timeLimit >= 0) {
+		std::lock_guard<std::mutex> lock(timerLock);
+		for (std::vector<Deadline>::iterator it = deadlines.begin(); it != deadlines.end(); ++it) {
+			if (it->player == session->player) {
+				deadlines.erase(it);
+				break;
+			}
+		}
+	}
+
+	std::ostringstream reply;
+	if (playersMove != NULL)
+		reply << playersMove->x << " " << playersMove->y;
+	else
+		reply << "-1 -1";
+	delete opponentsMove;
+	delete playersMove;
+	return sendLine(session, reply.str());
+}
+
+bool EngineServer::sendLine(Session *session, const std::string &line) {
+	std::string data = line + "\n";
+	size_t sent = 0;
+	while (sent < data.size()) {
+		ssize_t n = send(session->fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		sent += n;
+	}
+	return true;
+}
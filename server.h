@@ -0,0 +1,90 @@
+#ifndef __SERVER_H__
+#define __SERVER_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "player.h"
+using namespace std;
+
+#define SERVER_TABLE_KB 2048 //per session; many games share the host's memory
+
+/*
+ * One game played over one connection. The client speaks the same line protocol as the java framework does with
+ * wrapper.cpp: first the side ("Black" or "White"), answered with "Init done", then "x y msLeft" per move, answered
+ * with "x y". While busy, the session belongs to the worker running it; otherwise to the thread polling sockets.
+ */
+struct Session {
+	int fd;
+	Player *player;
+	std::string input; //bytes read but not yet handled
+	bool busy;
+	bool closing; //the connection is done with; deleted as soon as it is not busy
+	int turn;
+	std::chrono::steady_clock::time_point arrival; //when the line being handled was read
+};
+
+/*
+ * A move that must be cut short at the given time.
+ */
+struct Deadline {
+	std::chrono::steady_clock::time_point when;
+	Player *player;
+	int turn;
+};
+
+/*
+ * Long-running engine process serving many games at once over a Unix domain socket. One thread polls the
+ * listening socket and every idle session; complete request lines are queued for a fixed pool of workers, and a
+ * timer thread stops searches that reach their deadline, the way wrapper.cpp does for a single game. Sessions
+ * share all read-only engine data, including the mapped table file; each has its own Player and Board.
+ */
+class EngineServer {
+
+private:
+	std::string path;
+	int listenFd;
+	int wakeFds[2]; //written to whenever the set of sockets to poll changes
+	int numWorkers;
+	size_t tableKB;
+	const SharedTables *tables;
+	std::atomic<bool> stopping;
+
+	std::map<int, Session*> sessions; //owned by the polling thread
+
+	std::mutex queueLock;
+	std::condition_variable queueReady;
+	std::deque<Session*> queue;
+	std::atomic<int> inFlight; //sessions queued or being run
+	std::vector<Session*> released; //sessions workers are done with, to be polled again
+
+	std::mutex timerLock;
+	std::condition_variable timerChanged;
+	std::vector<Deadline> deadlines;
+
+	void wake();
+	void enqueue(Session *session);
+	void readSession(Session *session);
+	void workerLoop();
+	void timerLoop();
+	bool handleLine(Session *session, const std::string &line);
+	bool sendLine(Session *session, const std::string &line);
+
+public:
+	EngineServer(const char *socketPath, int workers, size_t sessionTableKB, const SharedTables *sharedTables);
+	~EngineServer();
+
+	bool listen();
+	void run();
+	void stop();
+
+	std::atomic<unsigned long> sessionsServed;
+};
+
+#endif
@@ -0,0 +1,197 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tables.h"
+
+/*
+ * FNV-1a over 64-bit words; a trailing partial word is zero-extended. Section sizes are padded to TABLE_ALIGN in
+ * the file, but the checksum only covers the real size.
+ */
+uint64_t tableChecksum(const void *data, size_t size, uint64_t seed) {
+	const unsigned char *bytes = static_cast<const unsigned char *>(data);
+	uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		h = (h ^ word) * 0x100000001b3ULL;
+	}
+	if (i < size) {
+		uint64_t word = 0;
+		memcpy(&word, bytes + i, size - i);
+		h = (h ^ word) * 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static size_t alignUp(size_t n) {
+	return (n + TABLE_ALIGN - 1) & ~(size_t) (TABLE_ALIGN - 1);
+}
+
+static uint64_t headerChecksum(const TableFileHeader &header, const TableSection *sections) {
+	TableFileHeader copy = header;
+	copy.headerChecksum = 0;
+	uint64_t h = tableChecksum(&copy, sizeof(copy), 0);
+	return tableChecksum(sections, header.sectionCount * sizeof(TableSection), h);
+}
+
+void TableFileWriter::addSection(TableId id, const void *data, size_t size) {
+	ids.push_back(id);
+	contents.push_back(std::string(static_cast<const char *>(data), size));
+}
+
+/*
+ * Writes to a temporary file renamed over path at the end, so a process mapping the old file never sees a
+ * half-written one. Returns false on any I/O error.
+ */
+bool TableFileWriter::write(const char *path) {
+	TableFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, TABLE_MAGIC, 4);
+	header.version = TABLE_FILE_VERSION;
+	header.sectionCount = ids.size();
+	std::vector<TableSection> sections(ids.size());
+	size_t offset = alignUp(sizeof(header) + sections.size() * sizeof(TableSection));
+	for (unsigned int i = 0; i < ids.size(); i++) {
+		memset(&sections[i], 0, sizeof(TableSection));
+		sections[i].id = ids[i];
+		sections[i].offset = offset;
+		sections[i].size = contents[i].size();
+		sections[i].checksum = tableChecksum(contents[i].data(), contents[i].size(), ids[i]);
+		offset = alignUp(offset + contents[i].size());
+	}
+	header.fileSize = offset;
+	header.headerChecksum = headerChecksum(header, sections.empty() ? NULL : &sections[0]);
+
+	std::string file(offset, '\0');
+	memcpy(&file[0], &header, sizeof(header));
+	if (!sections.empty())
+		memcpy(&file[sizeof(header)], &sections[0], sections.size() * sizeof(TableSection));
+	for (unsigned int i = 0; i < ids.size(); i++)
+		if (!contents[i].empty())
+			memcpy(&file[sections[i].offset], contents[i].data(), contents[i].size());
+
+	std::string temporary = std::string(path) + ".tmp";
+	FILE *out = fopen(temporary.c_str(), "wb");
+	if (out == NULL)
+		return false;
+	bool ok = fwrite(file.data(), 1, file.size(), out) == file.size();
+	ok = (fclose(out) == 0) && ok;
+	if (ok)
+		ok = rename(temporary.c_str(), path) == 0;
+	else
+		remove(temporary.c_str());
+	return ok;
+}
+
+SharedTables::SharedTables() {
+	base = NULL;
+	size = 0;
+	sections = NULL;
+	sectionCount = 0;
+}
+
+SharedTables::~SharedTables() {
+	unmap();
+}
+
+/*
+ * Maps the file and checks its header and section directory. The section contents are not read; see verify().
+ */
+bool SharedTables::map(const char *path) {
+	unmap();
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		error = std::string(path) + ": " + strerror(errno);
+		return false;
+	}
+	struct stat st;
+	if (fstat(fd, &st) < 0 || (size_t) st.st_size < sizeof(TableFileHeader)) {
+		close(fd);
+		error = std::string(path) + ": too short for a table file";
+		return false;
+	}
+	void *mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		error = std::string(path) + ": " + strerror(errno);
+		return false;
+	}
+	base = static_cast<const unsigned char *>(mapping);
+	size = st.st_size;
+
+	const TableFileHeader *header = reinterpret_cast<const TableFileHeader *>(base);
+	const TableSection *directory = reinterpret_cast<const TableSection *>(base + sizeof(TableFileHeader));
+	if (memcmp(header->magic, TABLE_MAGIC, 4) != 0)
+		error = "not a table file";
+	else if (header->version != TABLE_FILE_VERSION)
+		error = "table file version " + std::to_string(header->version) + ", expected "
+			+ std::to_string(TABLE_FILE_VERSION);
+	else if (header->fileSize != size)
+		error = "table file size does not match its header";
+	else if (header->sectionCount > TABLE_MAX_SECTIONS
+			|| sizeof(TableFileHeader) + header->sectionCount * sizeof(TableSection) > size)
+		error = "bad section count";
+	else if (headerChecksum(*header, directory) != header->headerChecksum)
+		error = "table file header checksum mismatch";
+	else
+		error.clear();
+	for (uint32_t i = 0; error.empty() && i < header->sectionCount; i++) {
+		if (directory[i].offset % TABLE_ALIGN != 0 || directory[i].offset > size
+				|| directory[i].size > size - directory[i].offset)
+			error = "section " + std::to_string(directory[i].id) + " out of bounds";
+	}
+	if (!error.empty()) {
+		error = std::string(path) + ": " + error;
+		unmap();
+		return false;
+	}
+	sections = directory;
+	sectionCount = header->sectionCount;
+	return true;
+}
+
+void SharedTables::unmap() {
+	if (base != NULL)
+		munmap(const_cast<unsigned char *>(base), size);
+	base = NULL;
+	size = 0;
+	sections = NULL;
+	sectionCount = 0;
+}
+
+bool SharedTables::isMapped() const {
+	return base != NULL;
+}
+
+/*
+ * Checks every section against its checksum, which touches every page of the file. Worth doing once per host
+ * (e.g. by a long-running server, or after copying the file), not in every engine process.
+ */
+bool SharedTables::verify() const {
+	for (uint32_t i = 0; i < sectionCount; i++) {
+		if (tableChecksum(base + sections[i].offset, sections[i].size, sections[i].id) != sections[i].checksum) {
+			error = "section " + std::to_string(sections[i].id) + " checksum mismatch";
+			return false;
+		}
+	}
+	return true;
+}
+
+/*
+ * Start of the section with the given id and its size in bytes, or NULL if the file has none.
+ */
+const void *SharedTables::section(TableId id, size_t &sectionSize) const {
+	for (uint32_t i = 0; i < sectionCount; i++) {
+		if (sections[i].id == (uint32_t) id) {
+			sectionSize = sections[i].size;
+			return base + sections[i].offset;
+		}
+	}
+	sectionSize = 0;
+	return NULL;
+}
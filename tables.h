@@ -0,0 +1,89 @@
+#ifndef __TABLES_H__
+#define __TABLES_H__
+
+#include <cstddef>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+/*
+ * Precomputed engine data lives in one versioned file that every engine process maps read-only and shared, so
+ * the pages are in memory once per host however many games run, and startup costs a map call instead of a load.
+ *
+ * Layout (host byte order):
+ *   TableFileHeader
+ *   TableSection[sectionCount]
+ *   section data, each starting on a TABLE_ALIGN boundary and zero-padded to one
+ * headerChecksum covers the header (with the field itself zero) and the section directory; each section has its
+ * own checksum, which verify() checks.
+ */
+#define TABLE_MAGIC "OTBL"
+#define TABLE_FILE_VERSION 1
+#define TABLE_ALIGN 64
+#define TABLE_MAX_SECTIONS 64
+#define TABLE_DEFAULT_PATH "statesalestax.tbl"
+
+enum TableId {
+	TABLE_BOOK = 1
+};
+
+struct TableFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t sectionCount;
+	uint32_t reserved;
+	uint64_t fileSize;
+	uint64_t headerChecksum;
+};
+
+struct TableSection {
+	uint32_t id;
+	uint32_t reserved;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t checksum;
+};
+
+uint64_t tableChecksum(const void *data, size_t size, uint64_t seed);
+
+/*
+ * Collects sections and writes them out as a table file.
+ */
+class TableFileWriter {
+
+private:
+	std::vector<uint32_t> ids;
+	std::vector<std::string> contents;
+
+public:
+	void addSection(TableId id, const void *data, size_t size);
+	bool write(const char *path);
+};
+
+/*
+ * A table file mapped into memory. Everything handed out points into the mapping and stays valid until unmap()
+ * or destruction. Nothing is ever written, so any number of threads may read at once.
+ */
+class SharedTables {
+
+private:
+	const unsigned char *base;
+	size_t size;
+	const TableSection *sections;
+	uint32_t sectionCount;
+
+public:
+	SharedTables();
+	~SharedTables();
+
+	bool map(const char *path);
+	void unmap();
+	bool isMapped() const;
+	bool verify() const;
+	const void *section(TableId id, size_t &sectionSize) const;
+
+	mutable std::string error; //why the last map() or verify() failed
+};
+
+#endif
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstring>
+#include "telemetry.h"
+
+static const char *PHASE_NAMES[TIME_PHASES] = {"opening", "midgame", "endgame"};
+
+TimeModel::TimeModel() {
+	memset(phases, 0, sizeof(phases));
+	phase = 0;
+	lastNodes = 0;
+	pendingPrediction = 0;
+}
+
+/*
+ * Phase 0 has more than 35 empty squares, phase 1 more than 20, phase 2 the rest.
+ */
+int TimeModel::phaseOf(int empties) {
+	if (empties > 35)
+		return 0;
+	if (empties > 20)
+		return 1;
+	return 2;
+}
+
+void TimeModel::startMove(int empties) {
+	phase = phaseOf(empties);
+	lastNodes = 0;
+	pendingPrediction = 0;
+}
+
+/*
+ * Time in ms the next iteration of the current move is expected to take: the nodes of the last one times the
+ * branching factor, at the phase's speed. 0 if there is nothing to go on yet.
+ */
+double TimeModel::predictMs() {
+	PhaseModel &model = phases[phase];
+	if (lastNodes < TIME_MODEL_MIN_NODES || model.rateSamples == 0 || model.branchingSamples == 0)
+		return 0;
+	return lastNodes * model.branching / model.nodesPerMs;
+}
+
+/*
+ * Whether to start the next iteration, elapsedMs into a move with the given time limit. Without a prediction, it
+ * is started if no more than half the time is gone.
+ */
+bool TimeModel::nextIterationFits(int elapsedMs, int timeLimit) {
+	pendingPrediction = predictMs();
+	bool fits;
+	if (pendingPrediction > 0)
+		fits = elapsedMs + TIME_MODEL_MARGIN * pendingPrediction <= timeLimit;
+	else
+		fits = elapsedMs <= timeLimit / 2;
+	if (!fits)
+		phases[phase].skipped++;
+	return fits;
+}
+
+/*
+ * Records an iteration of the current move that searched the given number of nodes in ms milliseconds, and either
+ * completed or was stopped.
+ */
+void TimeModel::endIteration(unsigned long long nodes, double ms, bool completed) {
+	PhaseModel &model = phases[phase];
+	if (!completed) {
+		model.cutOff++;
+		pendingPrediction = 0;
+		return;
+	}
+	if (pendingPrediction > 0) {
+		model.predictedMs += pendingPrediction;
+		model.actualMs += ms;
+	}
+	if (nodes >= TIME_MODEL_MIN_NODES && ms > 0) {
+		double rate = nodes / ms;
+		model.nodesPerMs = model.rateSamples == 0 ? rate
+			: (1 - TIME_MODEL_DECAY) * model.nodesPerMs + TIME_MODEL_DECAY * rate;
+		model.rateSamples++;
+	}
+	if (lastNodes >= TIME_MODEL_MIN_NODES) {
+		double growth = (double) nodes / lastNodes;
+		model.branching = model.branchingSamples == 0 ? growth
+			: (1 - TIME_MODEL_DECAY) * model.branching + TIME_MODEL_DECAY * growth;
+		model.branchingSamples++;
+	}
+	lastNodes = nodes;
+	pendingPrediction = 0;
+}
+
+void TimeModel::endMove(const MoveTiming &timing) {
+	moves.push_back(timing);
+	PhaseModel &model = phases[phaseOf(timing.empties)];
+	model.moves++;
+	model.totalMs += timing.timeMs;
+	model.maxMs = std::max(model.maxMs, timing.timeMs);
+	model.totalDepth += timing.depth;
+	if (timing.timeLimit > 0)
+		model.maxShare = std::max(model.maxShare, (double) timing.timeMs / timing.timeLimit);
+}
+
+/*
+ * Per-phase table of where the time went and what the model learned, and the move that came closest to running
+ * out of time.
+ */
+void TimeModel::writeSummary(FILE *out) {
+	fprintf(out, "phase    moves  mean ms  max ms  max %%limit  depth  knodes/s  branching  skipped  cut off  "
+		"actual/predicted\n");
+	for (int p = 0; p < TIME_PHASES; p++) {
+		PhaseModel &model = phases[p];
+		if (model.moves == 0)
+			continue;
+		fprintf(out, "%-8s %5d %8.1f %7d %10.0f%% %6.2f %9.0f %10.2f %8d %8d", PHASE_NAMES[p], model.moves,
+			(double) model.totalMs / model.moves, model.maxMs, 100 * model.maxShare,
+			(double) model.totalDepth / model.moves, model.nodesPerMs, model.branching, model.skipped, model.cutOff);
+		if (model.predictedMs > 0)
+			fprintf(out, " %17.2f", model.actualMs / model.predictedMs);
+		fprintf(out, "\n");
+	}
+	int closest = -1;
+	for (unsigned int i = 0; i < moves.size(); i++) {
+		if (moves[i].msLeft >= 0 && (closest < 0
+				|| moves[i].msLeft - moves[i].timeMs < moves[closest].msLeft - moves[closest].timeMs))
+			closest = i;
+	}
+	if (closest >= 0) {
+		fprintf(out, "closest to the clock: move %d, %d ms left after it\n", closest + 1,
+			moves[closest].msLeft - moves[closest].timeMs);
+	}
+}
@@ -0,0 +1,73 @@
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <cstdio>
+#include <vector>
+using namespace std;
+
+// Game phases the model keeps apart, by empty squares: they match the switches in Player::evaluate, so leaves cost
+// about the same within a phase.
+#define TIME_PHASES 3
+#define TIME_MODEL_DECAY 0.25 //weight of a new sample in the running averages
+#define TIME_MODEL_MIN_NODES 200 //smaller iterations are too quick to say anything about speed or growth
+#define TIME_MODEL_MARGIN 1.25 //an iteration is started only if this much more than its predicted time is left
+
+/*
+ * What happened on one of our moves.
+ */
+struct MoveTiming {
+	int empties;
+	int msLeft; //as received
+	int timeLimit; //given by getTimeLimit, -1 if none
+	int timeMs; //wall time spent in doMove
+	int depth; //deepest completed iteration
+	unsigned long long nodes;
+};
+
+/*
+ * Running estimates for one phase, and the totals the summary is made of.
+ */
+struct PhaseModel {
+	double nodesPerMs;
+	double branching; //nodes of an iteration over those of the one before
+	int rateSamples;
+	int branchingSamples;
+
+	int moves;
+	long long totalMs;
+	int maxMs;
+	double maxShare; //largest fraction of a time limit used
+	long long totalDepth;
+	int skipped; //iterations not started because they were predicted not to finish
+	int cutOff; //iterations started and then stopped at the time limit
+	double predictedMs, actualMs; //over completed iterations that had a prediction
+};
+
+/*
+ * Per-move time telemetry, and an online model of search speed (nodes per millisecond) and branching factor per
+ * phase. Iterative deepening asks it whether the next iteration can finish in the time left before starting it.
+ */
+class TimeModel {
+
+private:
+	PhaseModel phases[TIME_PHASES];
+	int phase;
+	unsigned long long lastNodes; //of the last completed iteration of the current move
+	double pendingPrediction; //for the iteration running now, in ms, 0 if none
+
+	static int phaseOf(int empties);
+
+public:
+	TimeModel();
+
+	std::vector<MoveTiming> moves;
+
+	void startMove(int empties);
+	double predictMs();
+	bool nextIterationFits(int elapsedMs, int timeLimit);
+	void endIteration(unsigned long long nodes, double ms, bool completed);
+	void endMove(const MoveTiming &timing);
+	void writeSummary(FILE *out);
+};
+
+#endif
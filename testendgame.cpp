@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <ctime>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "testutil.h"
+
+// Endgame benchmark: searches a fixed set of late-game positions to the end of the game with the transposition
+// table, Enhanced Transposition Cutoff and symmetric hashing switched on one after the other, and reports nodes
+// and time for each. Every configuration must agree on the score.
+//
+// usage: testendgame [empties] [positions]
+
+struct Config {
+    const char *name;
+    bool useTable;
+    bool useETC;
+    bool useSymmetry;
+};
+
+int main(int argc, char *argv[]) {
+    seedRandom(12345);
+    int empties = (argc > 1) ? atoi(argv[1]) : 12;
+    int count = (argc > 2) ? atoi(argv[2]) : 10;
+
+    std::vector<Board*> positions;
+    std::vector<Side> sides;
+    while ((int) positions.size() < count) {
+        Board *board = new Board();
+        Side toMove;
+        if (randomPosition(board, empties, toMove)) {
+            positions.push_back(board);
+            sides.push_back(toMove);
+        } else {
+            delete board;
+        }
+    }
+
+    Config configs[] = {
+        {"alpha-beta", false, false, false},
+        {"+ table", true, false, false},
+        {"+ ETC", true, true, false},
+        {"+ symmetry", true, true, true}
+    };
+    int numConfigs = sizeof(configs) / sizeof(configs[0]);
+
+    std::vector<int> scores(count);
+    unsigned long long baseNodes = 0;
+    bool agree = true;
+    printf("%d positions, %d empties, searched to the end\n", count, empties);
+    for (int c = 0; c < numConfigs; c++) {
+        unsigned long long nodes = 0;
+        clock_t start = clock();
+        for (int i = 0; i < count; i++) {
+            Player *player = new Player(sides[i]);
+            player->useTable = configs[c].useTable;
+            player->useETC = configs[c].useETC;
+            player->useSymmetry = configs[c].useSymmetry;
+            int score = player->getBestScore(positions[i], empties, INT_MIN, INT_MAX, true);
+            if (c == 0)
+                scores[i] = score;
+            else if (score != scores[i])
+                agree = false;
+            nodes += player->nodes;
+            delete player;
+        }
+        double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+        if (c == 0)
+            baseNodes = nodes;
+        printf("%-12s %12llu nodes (%5.1f%%) %8.2f s\n", configs[c].name, nodes,
+            100.0 * nodes / baseNodes, seconds);
+    }
+
+    if (!agree) {
+        printf("Scores differ between configurations\n");
+        return 1;
+    }
+    printf("All configurations agree\n");
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "testutil.h"
+
+// Evaluation cache benchmark: plays the same set of games (random openings, then engine against engine) once
+// without and once with the evaluation cache. The cache must not change a single move. Reports the game time, the
+// cache hit rate and the cost of a full leaf evaluation against that of a hit.
+//
+// usage: testevalcache [games] [random opening moves]
+
+// Plays one game from the given opening; appends every move (x + 8*y, -1 for a pass) to moves and every position
+// with more than 20 empties to positions.
+static void playGame(const Board &opening, Side toMove, bool useEvalCache, std::vector<int> &moves,
+        std::vector<Board> &positions, unsigned long long &probes, unsigned long long &hits) {
+    Player *players[2] = {new Player(BLACK), new Player(WHITE)};
+    Board *boards[2] = {new Board(opening), new Board(opening)};
+    for (int p = 0; p < 2; p++) {
+        players[p]->setBoard(boards[p]);
+        players[p]->useEvalCache = useEvalCache;
+        players[p]->useSolver = false; //only the heuristic search uses the cache
+    }
+    Move *last = NULL;
+    bool passed = false;
+    while (true) {
+        int p = (toMove == BLACK) ? 0 : 1;
+        Move *move = players[p]->doMove(last, -1);
+        moves.push_back((move == NULL) ? -1 : move->getX() + 8 * move->getY());
+        if (boards[p]->countEmpty() > 20)
+            positions.push_back(*boards[p]);
+        delete last;
+        last = move;
+        if (move == NULL && passed)
+            break;
+        passed = (move == NULL);
+        toMove = (toMove == BLACK) ? WHITE : BLACK;
+    }
+    delete last;
+    for (int p = 0; p < 2; p++) {
+        probes += players[p]->evalCache.probes;
+        hits += players[p]->evalCache.hits;
+        delete players[p];
+        delete boards[p];
+    }
+}
+
+int main(int argc, char *argv[]) {
+    seedRandom(777);
+    int games = (argc > 1) ? atoi(argv[1]) : 6;
+    int openingMoves = (argc > 2) ? atoi(argv[2]) : 6;
+
+    std::vector<Board> openings;
+    std::vector<Side> sides;
+    while ((int) openings.size() < games) {
+        Board board;
+        Side toMove = BLACK;
+        playRandomMoves(board, toMove, openingMoves);
+        openings.push_back(board);
+        sides.push_back(toMove);
+    }
+
+    std::vector<int> moves[2];
+    std::vector<Board> positions;
+    double seconds[2];
+    unsigned long long probes = 0, hits = 0, unused = 0;
+    for (int cached = 0; cached < 2; cached++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int g = 0; g < games; g++) {
+            if (cached)
+                playGame(openings[g], sides[g], true, moves[1], positions, probes, hits);
+            else
+                playGame(openings[g], sides[g], false, moves[0], positions, unused, unused);
+        }
+        seconds[cached] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    printf("%d games, %lu moves\n", games, (unsigned long) moves[0].size());
+    printf("no cache:   %8.2f s\n", seconds[0]);
+    printf("eval cache: %8.2f s (%.2fx), %llu lookups, %.1f%% hits\n", seconds[1], seconds[0] / seconds[1], probes,
+        probes ? 100.0 * hits / probes : 0.0);
+
+    // Cost of one leaf evaluation: in full, and as a hit once every position is in the cache.
+    Player player(BLACK);
+    int repeats = 20;
+    long checksum = 0;
+    player.useEvalCache = false;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        for (unsigned int i = 0; i < positions.size(); i++)
+            checksum += player.getScore(&positions[i]);
+    double full = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    player.useEvalCache = true;
+    for (unsigned int i = 0; i < positions.size(); i++)
+        player.getScore(&positions[i]);
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        for (unsigned int i = 0; i < positions.size(); i++)
+            checksum -= player.getScore(&positions[i]);
+    double hit = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double calls = (double) repeats * positions.size();
+    printf("full evaluation: %8.1f ns/leaf\n", full / calls * 1e9);
+    printf("cache hit:       %8.1f ns/leaf\n", hit / calls * 1e9);
+
+    if (moves[0] != moves[1]) {
+        printf("The evaluation cache changed the moves played\n");
+        return 1;
+    }
+    if (checksum != 0) {
+        printf("Cached scores differ from full evaluations\n");
+        return 1;
+    }
+    printf("Same moves with and without the cache\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "bitboard.h"
+#include "ttable.h"
+
+// Transposition table microbenchmark: 1, 2, 4, ... threads hammer one shared table with a mix of 3 probes to 1
+// store over a common key space, so they keep colliding in the same buckets. Compared against the naive design
+// of one entry per slot behind a mutex. Every hit is checked against the data that was stored for its key; the
+// lockless table must never return a torn entry.
+//
+// usage: testhashtable [max threads] [table KB] [operations per thread]
+
+struct Result {
+    unsigned long long hits;
+    unsigned long long corrupt;
+};
+
+// Everything stored for a key is derived from it, so any hit can be checked.
+static int keyScore(uint64_t key) { return (int) (key >> 32); }
+static int keyDepth(uint64_t key) { return 1 + (key & 31); }
+static int keyMove(uint64_t key) { return (key >> 8) % 64; }
+
+static bool consistent(uint64_t key, const TableEntry &entry) {
+    return entry.score == keyScore(key) && entry.depth == keyDepth(key) && entry.move == keyMove(key)
+        && entry.bound == BOUND_EXACT;
+}
+
+// The design the bucketed table replaces: one entry per slot, and a lock around every access.
+class MutexTable {
+    std::vector<TableEntry> entries;
+    std::mutex lock;
+public:
+    MutexTable(size_t sizeKB) : entries(sizeKB * 1024 / sizeof(TableEntry)) {
+        for (size_t i = 0; i < entries.size(); i++)
+            entries[i].bound = BOUND_NONE;
+    }
+    bool probe(uint64_t key, TableEntry &entry) {
+        std::lock_guard<std::mutex> guard(lock);
+        const TableEntry &slot = entries[key % entries.size()];
+        if (slot.bound == BOUND_NONE || slot.key != key)
+            return false;
+        entry = slot;
+        return true;
+    }
+    void store(uint64_t key, int score, int depth, Bound bound, int move) {
+        std::lock_guard<std::mutex> guard(lock);
+        TableEntry &slot = entries[key % entries.size()];
+        slot.key = key;
+        slot.score = score;
+        slot.depth = depth;
+        slot.bound = bound;
+        slot.move = move;
+    }
+};
+
+template <class Table>
+static void worker(Table *table, int id, long ops, uint64_t keySpace, Result *result) {
+    uint64_t state = 0x1234567 + id;
+    result->hits = 0;
+    result->corrupt = 0;
+    for (long i = 0; i < ops; i++) {
+        state = mixBits(state + 0x9e3779b97f4a7c15ULL);
+        uint64_t key = mixBits(state % keySpace);
+        if ((state >> 60) < 4) {
+            table->store(key, keyScore(key), keyDepth(key), BOUND_EXACT, keyMove(key));
+        } else {
+            TableEntry entry;
+            if (table->probe(key, entry)) {
+                result->hits++;
+                if (!consistent(key, entry))
+                    result->corrupt++;
+            }
+        }
+    }
+}
+
+// Returns the number of corrupt hits.
+template <class Table>
+static unsigned long long run(const char *name, Table *table, int threads, long ops, uint64_t keySpace) {
+    std::vector<std::thread> pool;
+    std::vector<Result> results(threads);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++)
+        pool.push_back(std::thread(worker<Table>, table, t, ops, keySpace, &results[t]));
+    for (int t = 0; t < threads; t++)
+        pool[t].join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    unsigned long long hits = 0, corrupt = 0;
+    for (int t = 0; t < threads; t++) {
+        hits += results[t].hits;
+        corrupt += results[t].corrupt;
+    }
+    double total = (double) ops * threads;
+    printf("%-9s %2d threads %8.2f Mops/s  hit rate %5.1f%%  corrupt %llu\n", name, threads,
+        total / seconds / 1e6, 100.0 * hits / (total * 0.75), corrupt);
+    return corrupt;
+}
+
+int main(int argc, char *argv[]) {
+    int maxThreads = (argc > 1) ? atoi(argv[1]) : 4;
+    size_t sizeKB = (argc > 2) ? atoi(argv[2]) : TABLE_DEFAULT_KB;
+    long ops = (argc > 3) ? atol(argv[3]) : 4000000;
+
+    TranspositionTable table(sizeKB);
+    MutexTable mutexTable(sizeKB);
+    uint64_t keySpace = (uint64_t) 2 << table.sizeLog2(); //twice as many positions as entries
+    printf("%lu KB, 2^%d entries, %ld operations per thread, %u hardware threads\n", (unsigned long) sizeKB,
+        table.sizeLog2(), ops, std::thread::hardware_concurrency());
+
+    unsigned long long corrupt = 0;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        table.clear();
+        corrupt += run("lockless", &table, threads, ops, keySpace);
+        run("mutex", &mutexTable, threads, ops, keySpace);
+    }
+    if (corrupt > 0) {
+        printf("%llu torn entries from the lockless table\n", corrupt);
+        return 1;
+    }
+    printf("No torn entries\n");
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "testutil.h"
+
+// MCTS against alpha-beta: first measures raw MCTS playout speed on the opening position with 1, 2, 4, ...
+// threads, then plays a match from random openings, each opening once with either engine as black. Every move is
+// made under a clock and cut short at its time limit, as in a game.
+//
+// usage: testmatch [openings] [ms per side] [random opening moves]
+
+struct MatchStats {
+    int wins, losses, draws, discs, overruns;
+    double mctsSeconds, alphaBetaSeconds;
+};
+
+// Plays one game; returns the final disc difference for black.
+static int playGame(const Board &opening, Side toMove, bool mctsBlack, int msPerSide, MatchStats &stats) {
+    Player *players[2];
+    Board *boards[2];
+    for (int p = 0; p < 2; p++) {
+        bool mcts = (p == 0) == mctsBlack;
+        players[p] = new Player(p == 0 ? BLACK : WHITE, TABLE_DEFAULT_KB, 0, mcts ? ENGINE_MCTS : ENGINE_ALPHABETA);
+        boards[p] = new Board(opening);
+        players[p]->setBoard(boards[p]);
+    }
+    int msLeft[2] = {msPerSide, msPerSide};
+    Board board(opening);
+    Move *last = NULL;
+    bool passed = false;
+    while (true) {
+        int p = (toMove == BLACK) ? 0 : 1;
+        bool mcts = (p == 0) == mctsBlack;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int square = players[p]->doMoveTimed(last, msLeft[p]);
+        Move *move = (square < 0) ? NULL : new Move(square % 8, square / 8);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        msLeft[p] -= (int) (seconds * 1000);
+        if (msLeft[p] < 0)
+            stats.overruns++;
+        if (mcts)
+            stats.mctsSeconds += seconds;
+        else
+            stats.alphaBetaSeconds += seconds;
+        if (move != NULL)
+            board.doMove(move, toMove);
+        delete last;
+        last = move;
+        if (move == NULL && passed)
+            break;
+        passed = (move == NULL);
+        toMove = (toMove == BLACK) ? WHITE : BLACK;
+    }
+    delete last;
+    for (int p = 0; p < 2; p++) {
+        delete players[p];
+        delete boards[p];
+    }
+    return board.countBlack() - board.countWhite();
+}
+
+int main(int argc, char *argv[]) {
+    seedRandom(99);
+    int openings = (argc > 1) ? atoi(argv[1]) : 5;
+    int msPerSide = (argc > 2) ? atoi(argv[2]) : 10000;
+    int openingMoves = (argc > 3) ? atoi(argv[3]) : 4;
+
+    // Raw speed: one second of search from the opening position.
+    unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool(threads - 1);
+        MctsSearch search(&pool);
+        search.search(0x0000001008000000ULL, 0x0000000810000000ULL, 1000, 0);
+        printf("%2d threads: %9lld playouts/s, %d tree nodes\n", pool.size() + 1, search.playouts, search.treeNodes);
+    }
+
+    MatchStats stats = {0, 0, 0, 0, 0, 0, 0};
+    for (int g = 0; g < openings; g++) {
+        Board board;
+        Side toMove = BLACK;
+        playRandomMoves(board, toMove, openingMoves);
+        for (int mctsBlack = 1; mctsBlack >= 0; mctsBlack--) {
+            int black = playGame(board, toMove, mctsBlack, msPerSide, stats);
+            int mcts = mctsBlack ? black : -black;
+            if (mcts > 0)
+                stats.wins++;
+            else if (mcts < 0)
+                stats.losses++;
+            else
+                stats.draws++;
+            stats.discs += mcts;
+            printf("opening %d, MCTS %s: %+d\n", g, mctsBlack ? "black" : "white", mcts);
+        }
+    }
+    printf("MCTS against alpha-beta, %d ms a side: %d wins, %d losses, %d draws, %+d discs\n", msPerSide,
+        stats.wins, stats.losses, stats.draws, stats.discs);
+    printf("time used per game: MCTS %.2f s, alpha-beta %.2f s\n", stats.mctsSeconds / (2 * openings),
+        stats.alphaBetaSeconds / (2 * openings));
+    if (stats.overruns > 0) {
+        printf("%d moves over time\n", stats.overruns);
+        return 1;
+    }
+    return 0;
+}
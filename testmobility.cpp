@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "testutil.h"
+
+// Checks the bitboard mobility terms against straightforward square-by-square versions built on
+// Board::checkMove (the way getMobilityScore used to work) on every position of a set of random games, for both
+// sides, then times the two.
+//
+// usage: testmobility [games]
+
+static int referenceMobility(Board *board, Side side, Side other) {
+    int score = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            Move move(i, j);
+            if (board->checkMove(&move, side))
+                score++;
+            else if (board->checkMove(&move, other))
+                score--;
+        }
+    }
+    return score;
+}
+
+static int referenceCornerMobility(Board *board, Side side, Side other) {
+    int score = 0;
+    for (int i = 0; i < 8; i++) {
+        for (int j = 0; j < 8; j++) {
+            Move move(i, j);
+            int weight = ((i == 0 || i == 7) && (j == 0 || j == 7)) ? 4 : 1;
+            if (board->checkMove(&move, side))
+                score += weight;
+            if (board->checkMove(&move, other))
+                score -= weight;
+        }
+    }
+    return score;
+}
+
+// Empty squares next to a stone of the given color.
+static int referenceFrontier(Board *board, uint64_t stones) {
+    uint64_t taken = board->getBlackBits() | board->getWhiteBits();
+    int count = 0;
+    for (int x = 0; x < 8; x++) {
+        for (int y = 0; y < 8; y++) {
+            if ((taken >> (x + 8 * y)) & 1)
+                continue;
+            bool adjacent = false;
+            for (int dx = -1; dx <= 1; dx++) {
+                for (int dy = -1; dy <= 1; dy++) {
+                    int nx = x + dx, ny = y + dy;
+                    if (0 <= nx && nx < 8 && 0 <= ny && ny < 8 && ((stones >> (nx + 8 * ny)) & 1))
+                        adjacent = true;
+                }
+            }
+            if (adjacent)
+                count++;
+        }
+    }
+    return count;
+}
+
+static void randomGame(std::vector<Board> &positions) {
+    Board board;
+    Side toMove = BLACK;
+    while (!board.isDone()) {
+        positions.push_back(board);
+        std::vector<Move> moves = legalMoves(board, toMove);
+        if (moves.size() > 0)
+            board.doMove(&moves[nextRandom(moves.size())], toMove);
+        toMove = (toMove == BLACK) ? WHITE : BLACK;
+    }
+    positions.push_back(board);
+}
+
+int main(int argc, char *argv[]) {
+    seedRandom(4242);
+    int games = (argc > 1) ? atoi(argv[1]) : 200;
+    std::vector<Board> positions;
+    for (int i = 0; i < games; i++)
+        randomGame(positions);
+
+    Player *players[2] = {new Player(BLACK), new Player(WHITE)};
+    Side sides[2] = {BLACK, WHITE};
+    int mismatches = 0;
+    for (unsigned int i = 0; i < positions.size(); i++) {
+        Board *board = &positions[i];
+        for (int p = 0; p < 2; p++) {
+            Side side = sides[p];
+            Side other = sides[1 - p];
+            uint64_t own = (side == BLACK) ? board->getBlackBits() : board->getWhiteBits();
+            uint64_t opp = (side == BLACK) ? board->getWhiteBits() : board->getBlackBits();
+            if (players[p]->getMobilityScore(board) != referenceMobility(board, side, other))
+                mismatches++;
+            if (players[p]->getCornerMobilityScore(board) != referenceCornerMobility(board, side, other))
+                mismatches++;
+            if (players[p]->getPotentialMobilityScore(board)
+                    != referenceFrontier(board, opp) - referenceFrontier(board, own))
+                mismatches++;
+        }
+    }
+    printf("%lu positions, %d mismatches\n", (unsigned long) positions.size(), mismatches);
+
+    // Timing: both versions of getMobilityScore over every position, several times over.
+    int repeats = 20;
+    long checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        for (unsigned int i = 0; i < positions.size(); i++)
+            checksum += referenceMobility(&positions[i], BLACK, WHITE);
+    double reference = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; r++)
+        for (unsigned int i = 0; i < positions.size(); i++)
+            checksum -= players[0]->getMobilityScore(&positions[i]);
+    double bitboard = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double calls = (double) repeats * positions.size();
+    printf("checkMove mobility: %8.1f ns/call\n", reference / calls * 1e9);
+    printf("bitboard mobility:  %8.1f ns/call (%.0fx faster)\n", bitboard / calls * 1e9, reference / bitboard);
+    if (checksum != 0)
+        mismatches++;
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "testutil.h"
+
+// Multi-PV benchmark: on positions from random games, finds the best K moves once with a single multi-PV search and
+// once the old way, searching every root move on its own with that move forced. Both must agree on the K best
+// scores. Reports the nodes and time of each, next to those of a plain search for the best move alone, which K
+// separate searches would cost K times over.
+//
+// usage: testmultipv [positions] [depth] [random moves]
+
+#define BENCH_TABLE_KB 16384
+
+struct Cost {
+    unsigned long long nodes;
+    double seconds;
+};
+
+static void addCost(Cost &cost, Player &player, std::chrono::steady_clock::time_point start) {
+    cost.nodes += player.nodes;
+    cost.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Iterative deepening with every root move forced in turn; returns all root scores, best first.
+static std::vector<int> forcedScores(Board &board, Side side, int depth, Cost &cost) {
+    Player player(side, BENCH_TABLE_KB, 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<Move> moves = legalMoves(board, side);
+    std::vector<int> scores;
+    for (unsigned int i = 0; i < moves.size(); i++) {
+        Board child(board);
+        child.doMove(&moves[i], side);
+        int score = 0;
+        for (int d = 1; d <= depth; d++)
+            score = player.getBestScore(&child, d - 1, INT_MIN, INT_MAX, false);
+        scores.push_back(score);
+    }
+    std::sort(scores.begin(), scores.end(), std::greater<int>());
+    addCost(cost, player, start);
+    return scores;
+}
+
+static std::vector<RootLine> multiPV(Board &board, Side side, int depth, int k, Cost &cost) {
+    Player player(side, BENCH_TABLE_KB, 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<RootLine> lines = player.getBestMoves(&board, depth, k);
+    addCost(cost, player, start);
+    return lines;
+}
+
+static void plainSearch(Board &board, Side side, int depth, Cost &cost) {
+    Player player(side, BENCH_TABLE_KB, 1);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int d = 1; d <= depth; d++)
+        delete player.getBestMove(&board, d, INT_MIN, INT_MAX, true);
+    addCost(cost, player, start);
+}
+
+int main(int argc, char *argv[]) {
+    seedRandom(4242);
+    int numPositions = (argc > 1) ? atoi(argv[1]) : 20;
+    int depth = (argc > 2) ? atoi(argv[2]) : 6;
+    int randomMoves = (argc > 3) ? atoi(argv[3]) : 20;
+    const int ks[3] = {1, 3, 5};
+    int failures = 0;
+
+    std::vector<Board> positions;
+    std::vector<Side> sides;
+    while ((int) positions.size() < numPositions) {
+        Board board;
+        Side side = BLACK;
+        playRandomMoves(board, side, randomMoves);
+        if (legalMoves(board, side).size() >= 5) {
+            positions.push_back(board);
+            sides.push_back(side);
+        }
+    }
+
+    Cost plain = {0, 0}, forced = {0, 0}, multi[3] = {{0, 0}, {0, 0}, {0, 0}};
+    for (unsigned int p = 0; p < positions.size(); p++) {
+        plainSearch(positions[p], sides[p], depth, plain);
+        std::vector<int> scores = forcedScores(positions[p], sides[p], depth, forced);
+        for (int i = 0; i < 3; i++) {
+            std::vector<RootLine> lines = multiPV(positions[p], sides[p], depth, ks[i], multi[i]);
+            if ((int) lines.size() != ks[i]) {
+                failures++;
+                continue;
+            }
+            for (int j = 0; j < ks[i]; j++) {
+                if (lines[j].score != scores[j] || lines[j].pv.empty() || lines[j].pv[0] != lines[j].square)
+                    failures++;
+            }
+        }
+    }
+
+    printf("%d positions after %d random moves, depth %d\n", numPositions, randomMoves, depth);
+    printf("best move alone:        %12llu nodes %8.3f s\n", plain.nodes, plain.seconds);
+    printf("every root move forced: %12llu nodes %8.3f s\n", forced.nodes, forced.seconds);
+    for (int i = 0; i < 3; i++) {
+        printf("multi-PV, K = %d:        %12llu nodes %8.3f s  (%.2fx of K separate searches, %.2fx of forced)\n",
+            ks[i], multi[i].nodes, multi[i].seconds, multi[i].seconds / (ks[i] * plain.seconds),
+            multi[i].seconds / forced.seconds);
+    }
+    printf("%d disagreements with the forced searches\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "common.h"
+#include "board.h"
+#include "server.h"
+
+// Engine server test: starts an EngineServer on a temporary socket and plays a number of games on it at once, each
+// refereed by its own thread over two sessions (one per side) with a chess clock, the way the java framework runs
+// two players. Every move must be legal and in time. Reports session setup time against starting a fresh
+// statesalestax process, and games per second.
+//
+// usage: testserver [games] [workers] [ms per side]
+
+#define SOCKET_PATH "/tmp/testserver.sock"
+
+struct Connection {
+    int fd;
+    std::string input;
+};
+
+static bool connectServer(Connection &c) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SOCKET_PATH);
+    c.fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    return c.fd >= 0 && connect(c.fd, (struct sockaddr *) &address, sizeof(address)) == 0;
+}
+
+static bool sendLine(Connection &c, const std::string &line) {
+    std::string data = line + "\n";
+    return send(c.fd, data.data(), data.size(), MSG_NOSIGNAL) == (ssize_t) data.size();
+}
+
+static bool readLine(Connection &c, std::string &line) {
+    size_t end;
+    while ((end = c.input.find('\n')) == std::string::npos) {
+        char buffer[256];
+        ssize_t n = recv(c.fd, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return false;
+        c.input.append(buffer, n);
+    }
+    line = c.input.substr(0, end);
+    c.input.erase(0, end + 1);
+    return true;
+}
+
+struct GameResult {
+    bool ok;
+    int moves;
+    int overruns;
+    std::string error;
+};
+
+static double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void referee(int msPerSide, GameResult &result) {
+    result.ok = false;
+    result.moves = 0;
+    result.overruns = 0;
+    Connection players[2]; //black, white
+    const char *names[2] = {"Black", "White"};
+    for (int p = 0; p < 2; p++) {
+        std::string line;
+        if (!connectServer(players[p]) || !sendLine(players[p], names[p]) || !readLine(players[p], line)
+                || line != "Init done") {
+            result.error = "session setup failed";
+            return;
+        }
+    }
+
+    Board board;
+    int msLeft[2] = {msPerSide, msPerSide};
+    int lastX = -1, lastY = -1;
+    int p = 0;
+    bool passed = false;
+    while (true) {
+        char request[64];
+        snprintf(request, sizeof(request), "%d %d %d", lastX, lastY, msLeft[p]);
+        std::chrono::steady_clock::time_point moveStart = std::chrono::steady_clock::now();
+        std::string line;
+        if (!sendLine(players[p], request) || !readLine(players[p], line)) {
+            result.error = "connection lost";
+            return;
+        }
+        msLeft[p] -= (int) msSince(moveStart);
+        if (msLeft[p] < 0)
+            result.overruns++;
+        int x, y;
+        if (sscanf(line.c_str(), "%d %d", &x, &y) != 2) {
+            result.error = "bad reply " + line;
+            return;
+        }
+        Side side = (p == 0) ? BLACK : WHITE;
+        if (x < 0) {
+            if (board.hasMoves(side)) {
+                result.error = "pass with a legal move";
+                return;
+            }
+            if (passed)
+                break;
+            passed = true;
+        } else {
+            Move move(x, y);
+            if (!board.checkMove(&move, side)) {
+                result.error = "illegal move " + line;
+                return;
+            }
+            board.doMove(&move, side);
+            passed = false;
+        }
+        result.moves++;
+        lastX = x;
+        lastY = y;
+        p = 1 - p;
+    }
+    for (p = 0; p < 2; p++)
+        close(players[p].fd);
+    result.ok = true;
+}
+
+int main(int argc, char *argv[]) {
+    int games = (argc > 1) ? atoi(argv[1]) : 16;
+    int workers = (argc > 2) ? atoi(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+    int msPerSide = (argc > 3) ? atoi(argv[3]) : 4000;
+
+    EngineServer server(SOCKET_PATH, workers, SERVER_TABLE_KB, NULL);
+    if (!server.listen())
+        return 1;
+    std::thread serving(&EngineServer::run, &server);
+
+    // Setting up a session, one at a time, against starting a fresh process and telling it the game is over.
+    int runs = 10;
+    std::chrono::steady_clock::time_point setup = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        Connection c;
+        std::string line;
+        if (!connectServer(c) || !sendLine(c, "Black") || !readLine(c, line))
+            printf("session setup failed\n");
+        close(c.fd);
+    }
+    printf("session setup:    %6.2f ms\n", msSince(setup) / runs);
+    if (access("./statesalestax", X_OK) == 0) {
+        std::chrono::steady_clock::time_point spawn = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++) {
+            FILE *process = popen("./statesalestax Black < /dev/null", "r");
+            char line[64];
+            while (process != NULL && fgets(line, sizeof(line), process) != NULL)
+                ;
+            if (process != NULL)
+                pclose(process);
+        }
+        printf("process per game: %6.2f ms\n", msSince(spawn) / runs);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<GameResult> results(games);
+    std::vector<std::thread> referees;
+    for (int g = 0; g < games; g++)
+        referees.push_back(std::thread(referee, msPerSide, std::ref(results[g])));
+    for (int g = 0; g < games; g++)
+        referees[g].join();
+    double seconds = msSince(start) / 1000;
+    server.stop();
+    serving.join();
+
+    int failed = 0, moves = 0, overruns = 0;
+    for (int g = 0; g < games; g++) {
+        if (!results[g].ok) {
+            printf("game %d: %s\n", g, results[g].error.c_str());
+            failed++;
+            continue;
+        }
+        moves += results[g].moves;
+        overruns += results[g].overruns;
+    }
+    printf("%d games at once, %d workers, %d ms per side: %d moves in %.2f s (%.2f games/s)\n", games, workers,
+        msPerSide, moves, seconds, games / seconds);
+
+    if (failed > 0 || overruns > 0) {
+        printf("%d games failed, %d moves over time\n", failed, overruns);
+        return 1;
+    }
+    printf("All games legal and in time\n");
+    return 0;
+}
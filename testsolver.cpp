@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "bitboard.h"
+#include "endgame.h"
+#include "testutil.h"
+
+// Parallel endgame solver benchmark: solves a fixed set of positions with 1, 2, 4, ... threads and reports the
+// time to solve each set and the speedup over one thread. Every thread count must find the same scores.
+//
+// usage: testsolver [min empties] [max empties] [positions per count] [max threads]
+
+int main(int argc, char *argv[]) {
+    seedRandom(2024);
+    int minEmpties = (argc > 1) ? atoi(argv[1]) : 16;
+    int maxEmpties = (argc > 2) ? atoi(argv[2]) : 18;
+    int count = (argc > 3) ? atoi(argv[3]) : 4;
+    int maxThreads = (argc > 4) ? atoi(argv[4]) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<uint64_t> owns, opps;
+    std::vector<int> emptyCounts;
+    for (int empties = minEmpties; empties <= maxEmpties; empties++) {
+        for (int i = 0; i < count; ) {
+            uint64_t own, opp;
+            if (randomPosition(empties, own, opp)) {
+                owns.push_back(own);
+                opps.push_back(opp);
+                emptyCounts.push_back(empties);
+                i++;
+            }
+        }
+    }
+
+    printf("%lu positions, %d-%d empties, %u hardware threads\n", (unsigned long) owns.size(), minEmpties,
+        maxEmpties, std::thread::hardware_concurrency());
+    std::vector<int> scores(owns.size());
+    double baseSeconds = 0;
+    bool agree = true;
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        EndgameSolver solver(threads);
+        unsigned long long nodes = 0;
+        double seconds = 0;
+        for (unsigned int i = 0; i < owns.size(); i++) {
+            int move;
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            int score = solver.solve(owns[i], opps[i], move);
+            seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            nodes += solver.nodes;
+            if (threads == 1)
+                scores[i] = score;
+            else if (score != scores[i])
+                agree = false;
+        }
+        if (threads == 1)
+            baseSeconds = seconds;
+        printf("%2d threads %8.2f s %14llu nodes %8.2f Mnodes/s  speedup %.2f\n", solver.getThreads(), seconds,
+            nodes, nodes / seconds / 1e6, baseSeconds / seconds);
+    }
+
+    if (!agree) {
+        printf("Scores differ between thread counts\n");
+        return 1;
+    }
+    printf("All thread counts agree\n");
+    return 0;
+}
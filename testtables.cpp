@@ -0,0 +1,257 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "bitboard.h"
+#include "book.h"
+#include "tables.h"
+
+// Shared table file test: builds a small book, writes it, maps it back and checks that every opening position
+// finds a legal book move in all 8 orientations, consistently. Then damages copies of the file in various ways
+// (each of which must be rejected) and times mapping against reading the file into memory. Last, measures the
+// memory of N processes at once that each map a 64 MB table file and read all of it, against N that each read it
+// into private memory: mapped, the file must be in memory about once, not N times.
+//
+// usage: testtables [plies] [depth] [processes]
+
+#define TEST_PATH "/tmp/testtables.tbl"
+#define DAMAGED_PATH "/tmp/testtables-damaged.tbl"
+
+static std::string readFile(const char *path) {
+    std::string data;
+    FILE *in = fopen(path, "rb");
+    if (in == NULL)
+        return data;
+    char buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+        data.append(buffer, n);
+    fclose(in);
+    return data;
+}
+
+static void writeFile(const char *path, const std::string &data) {
+    FILE *out = fopen(path, "wb");
+    fwrite(data.data(), 1, data.size(), out);
+    fclose(out);
+}
+
+// Black and white masks of every position in the first plies moves, black to move at even ply counts.
+static void openingPositions(uint64_t own, uint64_t opp, int plies, std::vector<uint64_t> &positions) {
+    if (plies == 0)
+        return;
+    uint64_t moves = legalMoveMask(own, opp);
+    if (moves == 0)
+        return;
+    bool blackToMove = (popCount(own | opp) % 2 == 0);
+    positions.push_back(blackToMove ? own : opp);
+    positions.push_back(blackToMove ? opp : own);
+    while (moves) {
+        int square = firstSquare(moves);
+        moves &= moves - 1;
+        uint64_t flips = flipMask(own, opp, square);
+        openingPositions(opp ^ flips, own | flips | (1ULL << square), plies - 1, positions);
+    }
+}
+
+// Maps a copy of the file with one change made by damage(); returns true if it was rejected.
+static bool rejects(const std::string &file, void (*damage)(std::string &), bool needsVerify) {
+    std::string copy = file;
+    damage(copy);
+    writeFile(DAMAGED_PATH, copy);
+    SharedTables tables;
+    if (!tables.map(DAMAGED_PATH))
+        return true;
+    return needsVerify && !tables.verify();
+}
+
+enum TableUse {
+    USE_NONE, USE_MAPPED, USE_PRIVATE
+};
+
+// Rss and Pss of a process in KB, from /proc/<pid>/smaps_rollup.
+static bool processMemory(pid_t pid, long &rssKB, long &pssKB) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", (int) pid);
+    FILE *in = fopen(path, "r");
+    if (in == NULL)
+        return false;
+    rssKB = pssKB = -1;
+    char line[256];
+    while (fgets(line, sizeof(line), in) != NULL) {
+        sscanf(line, "Rss: %ld kB", &rssKB);
+        sscanf(line, "Pss: %ld kB", &pssKB);
+    }
+    fclose(in);
+    return rssKB >= 0 && pssKB >= 0;
+}
+
+// Starts n processes that each use the table file at path as use says and read every byte of it, waits until
+// all of them have, and returns their total Rss and Pss in KB. Pss charges each shared page to its processes in
+// equal parts, so the total counts a page once however many processes have it.
+static bool groupMemory(const char *path, TableUse use, int n, long &rssKB, long &pssKB) {
+    int ready[2], release[2];
+    if (pipe(ready) != 0 || pipe(release) != 0)
+        return false;
+    std::vector<pid_t> children;
+    for (int i = 0; i < n; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(ready[0]);
+            close(release[1]);
+            bool ok = true;
+            SharedTables tables;
+            std::string copy;
+            if (use == USE_MAPPED) {
+                ok = tables.map(path) && tables.verify(); //verify() reads the whole mapping
+            } else if (use == USE_PRIVATE) {
+                copy = readFile(path);
+                ok = !copy.empty();
+            }
+            char c = ok ? '1' : '0';
+            if (write(ready[1], &c, 1) != 1)
+                _exit(1);
+            read(release[0], &c, 1); //returns at EOF, once the parent has measured
+            _exit(0);
+        }
+        if (pid < 0)
+            break;
+        children.push_back(pid);
+    }
+    close(ready[1]);
+    close(release[0]);
+    bool ok = ((int) children.size() == n);
+    for (unsigned int i = 0; i < children.size(); i++) {
+        char c = '0';
+        if (read(ready[0], &c, 1) != 1 || c != '1')
+            ok = false;
+    }
+    rssKB = pssKB = 0;
+    for (unsigned int i = 0; ok && i < children.size(); i++) {
+        long rss, pss;
+        if (!processMemory(children[i], rss, pss))
+            ok = false;
+        rssKB += rss;
+        pssKB += pss;
+    }
+    close(release[1]);
+    close(ready[0]);
+    for (unsigned int i = 0; i < children.size(); i++)
+        waitpid(children[i], NULL, 0);
+    return ok;
+}
+
+static void badMagic(std::string &file) { file[0] = 'X'; }
+static void badVersion(std::string &file) { file[4]++; }
+static void truncated(std::string &file) { file.resize(file.size() - TABLE_ALIGN); }
+static void badDirectory(std::string &file) { file[sizeof(TableFileHeader) + 8]++; }
+static void badData(std::string &file) { file[file.size() - TABLE_ALIGN - 1] ^= 1; }
+
+int main(int argc, char *argv[]) {
+    int plies = (argc > 1) ? atoi(argv[1]) : 5;
+    int depth = (argc > 2) ? atoi(argv[2]) : 4;
+    int processes = (argc > 3) ? atoi(argv[3]) : 8;
+    int failures = 0;
+
+    std::vector<BookEntry> entries;
+    buildBook(plies, depth, entries);
+    TableFileWriter writer;
+    writer.addSection(TABLE_BOOK, &entries[0], entries.size() * sizeof(BookEntry));
+    if (!writer.write(TEST_PATH)) {
+        perror(TEST_PATH);
+        return 1;
+    }
+
+    SharedTables tables;
+    OpeningBook book;
+    if (!tables.map(TEST_PATH) || !tables.verify() || !book.attach(tables) || book.size() != entries.size()) {
+        printf("cannot map the book back: %s\n", tables.error.c_str());
+        return 1;
+    }
+    std::vector<uint64_t> positions;
+    openingPositions(0x0000000810000000ULL, 0x0000001008000000ULL, plies, positions);
+    int lookups = 0;
+    for (unsigned int i = 0; i < positions.size(); i += 2) {
+        bool blackToMove = (popCount(positions[i] | positions[i + 1]) % 2 == 0);
+        int square, score;
+        if (!book.find(positions[i], positions[i + 1], blackToMove, square, score)) {
+            failures++;
+            continue;
+        }
+        for (int t = 0; t < 8; t++) {
+            uint64_t black = transform(t, positions[i]), white = transform(t, positions[i + 1]);
+            uint64_t moves = blackToMove ? legalMoveMask(black, white) : legalMoveMask(white, black);
+            int turnedSquare, turnedScore;
+            lookups++;
+            if (!book.find(black, white, blackToMove, turnedSquare, turnedScore) || turnedScore != score)
+                failures++;
+            else if (!((moves >> turnedSquare) & 1))
+                failures++; //not a legal move in this orientation
+        }
+    }
+    printf("%lu book positions, %d lookups in all orientations, %d failures\n", (unsigned long) entries.size(),
+        lookups, failures);
+
+    std::string file = readFile(TEST_PATH);
+    int missed = 0;
+    missed += !rejects(file, badMagic, false);
+    missed += !rejects(file, badVersion, false);
+    missed += !rejects(file, truncated, false);
+    missed += !rejects(file, badDirectory, false);
+    missed += !rejects(file, badData, true);
+    printf("damaged files: %d of 5 accepted\n", missed);
+    failures += missed;
+
+    // Startup cost: mapping the file against reading it into private memory, for the book alone and with a
+    // 64 MB filler section standing in for larger tables.
+    std::string filler(64 << 20, '\1');
+    writer.addSection((TableId) 99, filler.data(), filler.size());
+    writer.write(DAMAGED_PATH);
+    std::string().swap(filler); //or every process forked below would start out with it
+    const char *paths[2] = {TEST_PATH, DAMAGED_PATH};
+    int runs[2] = {1000, 10};
+    for (int p = 0; p < 2; p++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs[p]; i++) {
+            SharedTables mapped;
+            OpeningBook mappedBook;
+            if (!mapped.map(paths[p]) || !mappedBook.attach(mapped))
+                failures++;
+        }
+        double mapUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        size_t bytes = 0;
+        for (int i = 0; i < runs[p]; i++)
+            bytes = readFile(paths[p]).size();
+        double readUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        printf("%10lu byte file: map %9.1f us, read %9.1f us\n", (unsigned long) bytes, mapUs / runs[p],
+            readUs / runs[p]);
+    }
+
+    // Memory of processes running at once, over that of as many processes without the tables.
+    long fileKB = readFile(DAMAGED_PATH).size() >> 10;
+    long rss[3], pss[3];
+    const char *uses[3] = {"no tables", "mapped", "private copies"};
+    for (int u = USE_NONE; u <= USE_PRIVATE; u++) {
+        if (!groupMemory(DAMAGED_PATH, (TableUse) u, processes, rss[u], pss[u])) {
+            printf("could not measure %d processes with %s\n", processes, uses[u]);
+            failures++;
+            rss[u] = pss[u] = 0;
+        }
+    }
+    for (int u = USE_MAPPED; u <= USE_PRIVATE; u++) {
+        printf("%d processes, %-14s: total Rss %7ld KB, Pss %7ld KB over no tables (file %ld KB)\n", processes,
+            uses[u], rss[u] - rss[USE_NONE], pss[u] - pss[USE_NONE], fileKB);
+    }
+    if (processes > 1 && pss[USE_MAPPED] - pss[USE_NONE] > 2 * (pss[USE_PRIVATE] - pss[USE_NONE]) / processes) {
+        printf("mapped tables are not shared between processes\n");
+        failures++;
+    }
+    remove(DAMAGED_PATH);
+    remove(TEST_PATH);
+    return failures == 0 ? 0 : 1;
+}
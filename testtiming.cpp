@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include "common.h"
+#include "player.h"
+#include "board.h"
+#include "gamerecord.h"
+
+// Time management regression test: replays the engine's side of recorded games under a clock and checks that no
+// move would have overrun. Each record is replayed by one player, so that its time model learns as it would in a
+// game; the clock starts at the msLeft of the first recorded move and loses the wall time of every replayed move.
+// A move overruns if it takes longer than the clock had left, or more than TIMING_SLACK_MS over its own time
+// limit. Without files, first plays a few games against itself with a short clock and records them.
+//
+// usage: testtiming [file ...]
+
+#define TIMING_PATH "/tmp/testtiming.rec"
+#define TIMING_SLACK_MS 25 //for the watchdog to notice and the search to unwind
+#define TIMING_GAMES 2
+#define TIMING_MS_PER_SIDE 100
+
+// Plays a game between two recording players, each with msPerSide on its clock.
+static void recordGame(int msPerSide) {
+    Player *players[2] = {new Player(BLACK), new Player(WHITE)};
+    Board *boards[2] = {new Board(), new Board()};
+    int msLeft[2] = {msPerSide, msPerSide};
+    for (int p = 0; p < 2; p++) {
+        players[p]->setBoard(boards[p]);
+        players[p]->recordTo(TIMING_PATH);
+    }
+    Move *last = NULL;
+    bool passed = false;
+    for (int p = 0; ; p = 1 - p) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        int square = players[p]->doMoveTimed(last, msLeft[p]);
+        Move *move = (square < 0) ? NULL : new Move(square % 8, square / 8);
+        msLeft[p] -= std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        delete last;
+        last = move;
+        if (move == NULL && passed)
+            break;
+        passed = (move == NULL);
+    }
+    delete last;
+    for (int p = 0; p < 2; p++) {
+        delete players[p]; //writes the record
+        delete boards[p];
+    }
+}
+
+struct Overruns {
+    int moves;
+    int recorded; //over time already in the record
+    int clock;
+    int limit;
+    int skipped; //untimed records
+};
+
+// Replays the engine's moves of one record; returns false if the record has an illegal move.
+static bool replayRecord(const GameRecord &record, Overruns &overruns) {
+    if (record.info.empty() || record.info[0].msLeft < 0) {
+        overruns.skipped++;
+        return true;
+    }
+    Side engineSide = record.engineBlack ? BLACK : WHITE;
+    Player player(engineSide, TABLE_DEFAULT_KB, 0, record.mcts ? ENGINE_MCTS : ENGINE_ALPHABETA);
+    Board board;
+    player.setBoard(&board);
+    int clock = record.info[0].msLeft;
+    int turn = 0;
+    Side side = BLACK;
+    for (unsigned int i = 0; i < record.moves.size(); i++) {
+        if (side == engineSide && turn < (int) record.info.size()) {
+            const MoveInfo &info = record.info[turn];
+            if ((int) info.timeMs > info.msLeft)
+                overruns.recorded++;
+            //the player plays its move on the board; put back the recorded position afterwards
+            Board before(board);
+            int timeLimit = player.getTimeLimit(clock);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            player.doMoveTimed(NULL, clock);
+            turn++;
+            int ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            overruns.moves++;
+            if (ms > clock) {
+                overruns.clock++;
+                printf("move %u: %d ms with %d ms on the clock\n", i + 1, ms, clock);
+            } else if (timeLimit >= 0 && ms > timeLimit + TIMING_SLACK_MS) {
+                overruns.limit++;
+                printf("move %u: %d ms against a limit of %d ms\n", i + 1, ms, timeLimit);
+            }
+            clock -= ms;
+            board = before;
+        }
+        int square = record.moves[i];
+        if (square != RECORD_PASS) {
+            Move move(square % 8, square / 8);
+            if (square > 63 || !board.checkMove(&move, side))
+                return false;
+            board.doMoveUnchecked(&move, side);
+        }
+        side = (side == BLACK) ? WHITE : BLACK;
+    }
+    player.timing.writeSummary(stdout);
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; i++)
+        paths.push_back(argv[i]);
+    if (paths.empty()) {
+        remove(TIMING_PATH);
+        for (int g = 0; g < TIMING_GAMES; g++)
+            recordGame(TIMING_MS_PER_SIDE);
+        paths.push_back(TIMING_PATH);
+    }
+
+    Overruns overruns = {0, 0, 0, 0, 0};
+    int records = 0, bad = 0;
+    for (unsigned int i = 0; i < paths.size(); i++) {
+        FILE *file = fopen(paths[i], "rb");
+        if (file == NULL) {
+            perror(paths[i]);
+            return 1;
+        }
+        GameRecordReader reader(file);
+        GameRecord record;
+        while (reader.next(record)) {
+            records++;
+            if (!replayRecord(record, overruns))
+                bad++;
+        }
+        if (reader.failed)
+            bad++;
+        fclose(file);
+    }
+    printf("%d records (%d untimed, %d damaged), %d moves replayed: %d over the clock, %d over their limit, "
+        "%d over the clock in the record\n", records, overruns.skipped, bad, overruns.moves, overruns.clock,
+        overruns.limit, overruns.recorded);
+    return (bad == 0 && overruns.clock == 0 && overruns.limit == 0 && overruns.recorded == 0) ? 0 : 1;
+}
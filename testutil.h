@@ -0,0 +1,90 @@
+#ifndef __TESTUTIL_H__
+#define __TESTUTIL_H__
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "common.h"
+#include "board.h"
+#include "bitboard.h"
+
+// Helpers shared by the test and benchmark programs: a small reproducible random number generator and random
+// positions to run on. Each program seeds the generator at the start of main, so that it always sees the same
+// positions.
+
+static unsigned int testSeed = 1;
+
+inline void seedRandom(unsigned int seed) {
+    testSeed = seed;
+}
+
+// A number in [0, n).
+inline int nextRandom(int n) {
+    testSeed = testSeed * 1103515245 + 12345;
+    return (testSeed >> 16) % n;
+}
+
+inline std::vector<Move> legalMoves(Board &board, Side side) {
+    std::vector<Move> moves;
+    for (int x = 0; x < 8; x++) {
+        for (int y = 0; y < 8; y++) {
+            Move move(x, y);
+            if (board.checkMove(&move, side))
+                moves.push_back(move);
+        }
+    }
+    return moves;
+}
+
+// Plays count random moves, passing when toMove has none, and leaves toMove the side to move after them.
+inline void playRandomMoves(Board &board, Side &toMove, int count) {
+    for (int i = 0; i < count; i++) {
+        std::vector<Move> moves = legalMoves(board, toMove);
+        if (moves.size() > 0)
+            board.doMove(&moves[nextRandom(moves.size())], toMove);
+        toMove = (toMove == BLACK) ? WHITE : BLACK;
+    }
+}
+
+// Plays random moves from the starting position until the board has the given number of empty squares. Returns
+// false if the game ended first.
+inline bool randomPosition(Board *board, int empties, Side &toMove) {
+    toMove = BLACK;
+    while (board->countEmpty() > empties) {
+        std::vector<Move> moves = legalMoves(*board, toMove);
+        Side other = (toMove == BLACK) ? WHITE : BLACK;
+        if (moves.size() == 0) {
+            if (!board->hasMoves(other))
+                return false;
+        } else {
+            board->doMove(&moves[nextRandom(moves.size())], toMove);
+        }
+        toMove = other;
+    }
+    return board->hasMoves(toMove);
+}
+
+// The same on bitboards, for programs that do not link the board: own is always the side to move. Also returns
+// false if the side to move has to pass.
+inline bool randomPosition(int empties, uint64_t &own, uint64_t &opp) {
+    own = 0x0000000810000000ULL; //black
+    opp = 0x0000001008000000ULL;
+    while (popCount(~(own | opp)) > empties) {
+        uint64_t moves = legalMoveMask(own, opp);
+        if (moves == 0) {
+            if (legalMoveMask(opp, own) == 0)
+                return false;
+        } else {
+            for (int skip = nextRandom(popCount(moves)); skip > 0; skip--)
+                moves &= moves - 1;
+            int square = firstSquare(moves);
+            uint64_t flips = flipMask(own, opp, square);
+            own |= flips | (1ULL << square);
+            opp ^= flips;
+        }
+        std::swap(own, opp);
+    }
+    return legalMoveMask(own, opp) != 0;
+}
+
+#endif
@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <thread>
+#include "threadpool.h"
+
+/*
+ * Threads a search uses (counting the calling one) unless told otherwise: one per hardware thread, up to
+ * POOL_MAX_THREADS. Beyond that the solver gains little, and the threads' stacks and heaps only bring a
+ * memory-limited process closer to failing.
+ */
+int defaultThreads() {
+	return std::min(std::max(1u, std::thread::hardware_concurrency()), (unsigned int) POOL_MAX_THREADS);
+}
+
+struct HelperStart {
+	ThreadPool *pool;
+	int helper;
+};
+
+/*
+ * Starts up to helpers threads with POOL_STACK_KB stacks. They sleep until a job is started.
+ */
+ThreadPool::ThreadPool(int helpers) {
+	generation = 0;
+	running = 0;
+	closing = false;
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setstacksize(&attr, POOL_STACK_KB * 1024);
+	for (int i = 1; i <= helpers; i++) {
+		HelperStart *start = new HelperStart();
+		start->pool = this;
+		start->helper = i;
+		pthread_t thread;
+		if (pthread_create(&thread, &attr, &ThreadPool::threadMain, start) != 0) {
+			delete start;
+			break; //out of threads or address space; the pool stays this size
+		}
+		threads.push_back(thread);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		closing = true;
+	}
+	wake.notify_all();
+	for (unsigned int i = 0; i < threads.size(); i++)
+		pthread_join(threads[i], NULL);
+}
+
+void *ThreadPool::threadMain(void *arg) {
+	HelperStart start = *(HelperStart *) arg;
+	delete (HelperStart *) arg;
+	start.pool->helperLoop(start.helper);
+	return NULL;
+}
+
+void ThreadPool::helperLoop(int helper) {
+	unsigned long done = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [&] { return closing || generation != done; });
+			if (closing)
+				return;
+			done = generation;
+		}
+		job(helper);
+		std::lock_guard<std::mutex> guard(lock);
+		if (--running == 0)
+			idle.notify_all();
+	}
+}
+
+/*
+ * Number of helper threads, not counting the caller.
+ */
+int ThreadPool::size() {
+	return threads.size();
+}
+
+/*
+ * Runs job(helper) on every helper thread, helper going from 1 to size(). The caller goes on with its own share
+ * of the work, and must wait() before starting another job.
+ */
+void ThreadPool::start(const std::function<void(int)> &job) {
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		this->job = job;
+		running = threads.size();
+		generation++;
+	}
+	wake.notify_all();
+}
+
+/*
+ * Waits until every helper has returned from the current job.
+ */
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> guard(lock);
+	idle.wait(guard, [&] { return running == 0; });
+}
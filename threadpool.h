@@ -0,0 +1,45 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <pthread.h>
+#include <vector>
+using namespace std;
+
+#define POOL_MAX_THREADS 16 //default thread count cap, however many hardware threads there are
+#define POOL_STACK_KB 256 //stack of a helper thread; the searches run on them keep little on the stack
+
+int defaultThreads();
+
+/*
+ * Helper threads started once and kept for the life of the pool, so that a search does not create threads of its
+ * own. If the system will not give all the threads asked for (say under a tight ulimit -v), the pool makes do with
+ * the ones it got, possibly none.
+ */
+class ThreadPool {
+
+private:
+	std::vector<pthread_t> threads;
+	std::mutex lock;
+	std::condition_variable wake; //a job was started, or the pool is closing
+	std::condition_variable idle; //the last helper finished the job
+	std::function<void(int)> job;
+	unsigned long generation; //jobs started so far
+	int running; //helpers still in the current job
+	bool closing;
+
+	static void *threadMain(void *arg);
+	void helperLoop(int helper);
+
+public:
+	ThreadPool(int helpers);
+	~ThreadPool();
+
+	int size();
+	void start(const std::function<void(int)> &job);
+	void wait();
+};
+
+#endif
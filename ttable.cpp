@@ -0,0 +1,189 @@
+#include <climits>
+#include <new>
+#include <sys/mman.h>
+#include "ttable.h"
+
+#define HUGE_PAGE_SIZE (2UL << 20)
+
+/*
+ * Layout of PackedEntry::data:
+ *   bits  0-31  score
+ *   bits 32-39  depth
+ *   bits 40-41  bound (BOUND_NONE marks an empty entry)
+ *   bits 42-48  move + 1 (0 for no move)
+ *   bits 49-56  age of the search that stored it
+ */
+static inline uint64_t pack(int score, int depth, Bound bound, int move, unsigned char age) {
+	return (uint64_t) (uint32_t) score | ((uint64_t) (depth & 0xff) << 32) | ((uint64_t) bound << 40)
+		| ((uint64_t) (move + 1) << 42) | ((uint64_t) age << 49);
+}
+
+static inline int dataDepth(uint64_t data) {
+	return (data >> 32) & 0xff;
+}
+
+static inline int dataBound(uint64_t data) {
+	return (data >> 40) & 3;
+}
+
+static inline unsigned char dataAge(uint64_t data) {
+	return (data >> 49) & 0xff;
+}
+
+/*
+ * Makes a table of at most sizeKB kilobytes (and at most TABLE_MAX_KB), rounded down to a power of two buckets.
+ */
+TranspositionTable::TranspositionTable(size_t sizeKB) {
+	buckets = NULL;
+	mapping = NULL;
+	allocate(sizeKB);
+}
+
+TranspositionTable::~TranspositionTable() {
+	release();
+}
+
+/*
+ * Tries for explicitly reserved huge pages first, then for transparent huge pages on a 2 MB aligned mapping;
+ * either way one TLB entry covers 2 MB of table instead of 4 KB. Falls back to ordinary pages if neither works.
+ */
+void TranspositionTable::allocate(size_t sizeKB) {
+	if (sizeKB > TABLE_MAX_KB)
+		sizeKB = TABLE_MAX_KB;
+	numBuckets = 1;
+	while ((numBuckets * 2) * sizeof(Bucket) <= sizeKB * 1024)
+		numBuckets *= 2;
+	size_t size = numBuckets * sizeof(Bucket);
+
+	void *base = MAP_FAILED;
+	size_t hugeSize = (size + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+#ifdef MAP_HUGETLB
+	base = mmap(NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if (base != MAP_FAILED) {
+		mapping = base;
+		mappedSize = hugeSize;
+	} else {
+		mappedSize = size + HUGE_PAGE_SIZE; //room to align the start
+		mapping = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapping == MAP_FAILED)
+			throw std::bad_alloc();
+		base = (void *) (((uintptr_t) mapping + HUGE_PAGE_SIZE - 1) & ~(uintptr_t) (HUGE_PAGE_SIZE - 1));
+#ifdef MADV_HUGEPAGE
+		madvise(base, size, MADV_HUGEPAGE);
+#endif
+	}
+
+	buckets = static_cast<Bucket *>(base);
+	for (size_t i = 0; i < numBuckets; i++)
+		new (&buckets[i]) Bucket();
+	age = 0;
+	clear();
+}
+
+void TranspositionTable::release() {
+	if (mapping != NULL)
+		munmap(mapping, mappedSize);
+	buckets = NULL;
+	mapping = NULL;
+}
+
+void TranspositionTable::resize(size_t sizeKB) {
+	release();
+	allocate(sizeKB);
+}
+
+void TranspositionTable::clear() {
+	for (size_t i = 0; i < numBuckets; i++) {
+		for (int j = 0; j < BUCKET_ENTRIES; j++) {
+			buckets[i].entries[j].check.store(0, std::memory_order_relaxed);
+			buckets[i].entries[j].data.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+/*
+ * Called once per move. Entries from earlier searches stay usable but are the first to be replaced.
+ */
+void TranspositionTable::newSearch() {
+	age++;
+}
+
+/*
+ * log2 of the number of entries.
+ */
+int TranspositionTable::sizeLog2() {
+	int log2 = 0;
+	while (((size_t) 1 << log2) < numBuckets * BUCKET_ENTRIES)
+		log2++;
+	return log2;
+}
+
+/*
+ * Copies the stored result for key into entry. Returns false if no entry of the bucket holds the position.
+ */
+bool TranspositionTable::probe(uint64_t key, TableEntry &entry) {
+	Bucket &bucket = buckets[key & (numBuckets - 1)];
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		uint64_t data = bucket.entries[i].data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+		if ((check ^ data) != key || dataBound(data) == BOUND_NONE)
+			continue;
+		entry.key = key;
+		entry.score = (int) (uint32_t) data;
+		entry.depth = dataDepth(data);
+		entry.bound = dataBound(data);
+		entry.move = (int) ((data >> 42) & 0x7f) - 1;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * If the position is already in the bucket, its entry is updated unless it holds a deeper result from this same
+ * search. Otherwise the new result takes an empty entry if there is one, else the entry worth least: entries left
+ * over from earlier searches go first, then the shallowest.
+ */
+void TranspositionTable::store(uint64_t key, int score, int depth, Bound bound, int move) {
+	Bucket &bucket = buckets[key & (numBuckets - 1)];
+	int victim = 0;
+	int victimWorth = INT_MAX;
+	for (int i = 0; i < BUCKET_ENTRIES; i++) {
+		uint64_t data = bucket.entries[i].data.load(std::memory_order_relaxed);
+		uint64_t check = bucket.entries[i].check.load(std::memory_order_relaxed);
+		if ((check ^ data) == key && dataBound(data) != BOUND_NONE) {
+			if (dataAge(data) == age && dataDepth(data) > depth)
+				return;
+			victim = i;
+			break;
+		}
+		int worth = (dataBound(data) == BOUND_NONE) ? -1 : dataDepth(data) + (dataAge(data) == age ? 256 : 0);
+		if (worth < victimWorth) {
+			victim = i;
+			victimWorth = worth;
+		}
+	}
+	uint64_t data = pack(score, depth, bound, move, age);
+	bucket.entries[victim].check.store(key ^ data, std::memory_order_relaxed);
+	bucket.entries[victim].data.store(data, std::memory_order_relaxed);
+}
+
+/*
+ * Makes an empty cache of 2^sizeLog2 entries.
+ */
+EvalCache::EvalCache(int sizeLog2) {
+	entries = new uint64_t[(size_t) 1 << sizeLog2];
+	mask = ((size_t) 1 << sizeLog2) - 1;
+	clear();
+}
+
+EvalCache::~EvalCache() {
+	delete[] entries;
+}
+
+void EvalCache::clear() {
+	for (size_t i = 0; i <= mask; i++)
+		entries[i] = 0;
+	probes = 0;
+	hits = 0;
+}
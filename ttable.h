@@ -0,0 +1,121 @@
+#ifndef __TTABLE_H__
+#define __TTABLE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+using namespace std;
+
+// WrapperPlayer.java runs us under "ulimit -v 786432" (768 MB of address space, for everything). The table may
+// take up to 512 MB of that, leaving the rest for code, thread stacks and the other search state.
+#define TABLE_MAX_KB 524288
+#define TABLE_DEFAULT_KB 16384
+
+enum Bound {
+	BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT
+};
+
+/*
+ * One stored search result, as handed out by probe(). Scores are always from the perspective of the player that
+ * owns the table, so BOUND_LOWER means "at least score" and BOUND_UPPER means "at most score" regardless of who
+ * was to move.
+ */
+struct TableEntry {
+	uint64_t key;
+	int score;
+	int depth;
+	int bound;
+	int move; // square (x + 8*y) of the best move, -1 if none
+};
+
+/*
+ * Stored form of an entry: the packed result and the key XOR-ed with it. Readers and writers never lock; a slot
+ * torn by two simultaneous writes (or read halfway through one) no longer satisfies check ^ data == key, so it
+ * reads as a miss instead of as a wrong result.
+ */
+struct PackedEntry {
+	std::atomic<uint64_t> check;
+	std::atomic<uint64_t> data;
+};
+
+#define BUCKET_ENTRIES 4
+
+/*
+ * Four entries filling exactly one cache line. A position may live in any entry of its bucket, so a probe costs
+ * one cache miss at most.
+ */
+struct alignas(64) Bucket {
+	PackedEntry entries[BUCKET_ENTRIES];
+};
+
+class TranspositionTable {
+
+private:
+	Bucket *buckets;
+	size_t numBuckets;
+	size_t mappedSize;
+	void *mapping;
+	unsigned char age;
+
+	void allocate(size_t sizeKB);
+	void release();
+
+public:
+	TranspositionTable(size_t sizeKB);
+	~TranspositionTable();
+
+	void resize(size_t sizeKB);
+	void clear();
+	void newSearch();
+	int sizeLog2();
+
+	bool probe(uint64_t key, TableEntry &entry);
+	void store(uint64_t key, int score, int depth, Bound bound, int move);
+
+	/*
+	 * Starts loading the bucket for key into the cache, so that a probe shortly after does not wait on memory.
+	 */
+	void prefetch(uint64_t key) {
+		__builtin_prefetch(&buckets[key & (numBuckets - 1)]);
+	}
+};
+
+#define EVAL_CACHE_LOG2 15 //32768 entries of 8 bytes, 256 KB
+
+/*
+ * Direct-mapped cache of leaf evaluations, kept apart from the transposition table: an evaluation does not depend
+ * on search depth or window, so a hit is always usable. Each entry packs the upper half of the key (with the low
+ * bit set, so that an empty entry never matches) and the score into one word, eight entries to a cache line. Used
+ * by one thread only.
+ */
+class EvalCache {
+
+private:
+	uint64_t *entries;
+	size_t mask;
+
+public:
+	EvalCache(int sizeLog2);
+	~EvalCache();
+
+	void clear();
+
+	bool probe(uint64_t key, int &score) {
+		probes++;
+		uint64_t entry = entries[key & mask];
+		if ((entry >> 32) != ((key >> 32) | 1))
+			return false;
+		hits++;
+		score = (int) (uint32_t) entry;
+		return true;
+	}
+
+	void store(uint64_t key, int score) {
+		entries[key & mask] = (((key >> 32) | 1) << 32) | (uint32_t) score;
+	}
+
+	unsigned long long probes;
+	unsigned long long hits;
+};
+
+#endif
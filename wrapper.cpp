@@ -1,47 +1,163 @@
 #include <iostream>
 #include <cstdlib>
+#include <cstdio>
 #include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include "player.h"
 using namespace std;
 
+// Connects to a running statesalestaxd, or returns -1.
+static int connectServer(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) return -1;
+    strcpy(address.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, (struct sockaddr *) &address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Passes the game through to the server line by line: the side first, then
+// every "x y msLeft" from the java side, each answered by the server.
+static int relay(int fd, const char *side) {
+    FILE *in = fdopen(fd, "r");
+    FILE *out = fdopen(dup(fd), "w");
+    fprintf(out, "%s\n", side);
+    fflush(out);
+    char reply[64];
+    string line;
+    while (fgets(reply, sizeof(reply), in) != NULL) {
+        cout << reply;
+        cout.flush();
+        if (!getline(cin, line)) break;
+        fprintf(out, "%s\n", line.c_str());
+        fflush(out);
+    }
+    fclose(in);
+    fclose(out);
+    return 0;
+}
+
+// Keeps the timing summary up to date in file, to be written at the end.
+static void checkpointTiming(Player *player, CheckpointFile *file) {
+    char *text = NULL;
+    size_t size = 0;
+    FILE *out = open_memstream(&text, &size);
+    if (out == NULL) return;
+    player->timing.writeSummary(out);
+    fclose(out);
+    file->update(text, size);
+    free(text);
+}
+
 int main(int argc, char *argv[]) {    
+    // cin/cout need not stay in step with C stdio; buffered output is
+    // flushed once per reply. This has to come before any stream is used.
+    ios::sync_with_stdio(false);
+    cin.tie(NULL);
+
     // Read in side the player is on.
-    if (argc != 2)  {
-        cerr << "usage: " << argv[0] << " side" << endl;
+    if (argc != 2 && argc != 3)  {
+        cerr << "usage: " << argv[0] << " side [recordfile]" << endl;
         exit(-1);
     }
     Side side = (!strcmp(argv[1], "Black")) ? BLACK : WHITE;
 
-    // Initialize player.
-    Player *player = new Player(side);
+    // With STATESALESTAX_SERVER set to a statesalestaxd socket, the game is
+    // played there and this process only relays; it plays by itself if the
+    // server cannot be reached.
+    const char *serverSocket = getenv("STATESALESTAX_SERVER");
+    if (serverSocket != NULL) {
+        int fd = connectServer(serverSocket);
+        if (fd >= 0) {
+            return relay(fd, (side == BLACK) ? "Black" : "White");
+        }
+        cerr << "cannot reach " << serverSocket << ", playing locally" << endl;
+    }
+
+    // Initialize player. The java framework passes only the side, so the
+    // game record file and the engine can also come from the environment.
+    const char *engine = getenv("STATESALESTAX_ENGINE");
+    bool mcts = (engine != NULL && !strcmp(engine, "mcts"));
+    Player *player = new Player(side, TABLE_DEFAULT_KB, 0, mcts ? ENGINE_MCTS : ENGINE_ALPHABETA);
+    const char *recordFile = (argc == 3) ? argv[2] : getenv("STATESALESTAX_RECORD");
+    const char *tableKB = getenv("STATESALESTAX_HASH_KB");
+    if (tableKB != NULL) {
+        player->setTableSize(atoi(tableKB));
+    }
+    if (recordFile != NULL) {
+        player->recordTo(recordFile);
+    }
+
+    // WrapperPlayer.java closes our streams and sends SIGTERM at once at the
+    // end of a game, so the record is kept ready to be written from there.
+    writeCheckpointsOnSignal();
+
+    // Precomputed tables are mapped, not loaded, and shared with every
+    // other engine process using the same file. Playing without them is
+    // fine unless a file was asked for by name.
+    SharedTables tables;
+    const char *tablesFile = getenv("STATESALESTAX_TABLES");
+    if (tables.map((tablesFile != NULL) ? tablesFile : TABLE_DEFAULT_PATH)) {
+        player->setTables(&tables);
+    } else if (tablesFile != NULL) {
+        cerr << tables.error << endl;
+    }
 
     // Tell java wrapper that we are done initializing.
-    cout << "Init done" << endl;
+    cout << "Init done\n";
     cout.flush();    
     
+    // With STATESALESTAX_TIMING set, a summary of where the time went is
+    // appended to that file at the end of the game, or when we are killed.
+    const char *timingPath = getenv("STATESALESTAX_TIMING");
+    CheckpointFile *timingFile = NULL;
+    if (timingPath != NULL) {
+        timingFile = new CheckpointFile(timingPath);
+    }
+
     int moveX, moveY, msLeft;    
 
-    // Get opponent's move and time left for player each turn.
+    // Get opponent's move and time left for player each turn. The move is
+    // sent as soon as it is known, even if it was cut off at the deadline
+    // and the search is still unwinding.
     while (cin >> moveX >> moveY >> msLeft) {
         Move *opponentsMove = NULL;
         if (moveX >= 0 && moveY >= 0) {
             opponentsMove = new Move(moveX, moveY);
         }
-        
-        // Get player's move and output to java wrapper.
-        Move *playersMove = player->doMove(opponentsMove, msLeft);                        
-        if (playersMove != NULL) {                  
-            cout << playersMove->x << " " << playersMove->y << endl;
-        } else {
-            cout << "-1 -1" << endl;
+
+        player->doMoveTimed(opponentsMove, msLeft, [](int square) {
+            // Output player's move to java wrapper.
+            if (square >= 0) {
+                cout << square % 8 << " " << square / 8 << '\n';
+            } else {
+                cout << "-1 -1\n";
+            }
+            cout.flush();
+            cerr.flush();
+        });
+        player->checkpointRecord();
+        if (timingFile != NULL) {
+            checkpointTiming(player, timingFile);
         }
-        cout.flush();
-        cerr.flush();
         
-        // Delete move objects.
         if (opponentsMove != NULL) delete opponentsMove;
-        if (playersMove != NULL) delete playersMove; 
     }
 
+    if (timingFile != NULL) {
+        timingFile->write();
+        delete timingFile;
+    }
+
+    // Writes out the game record, if any.
+    delete player;
     return 0;
 }